@@ -0,0 +1,76 @@
+#include "aot.h"
+#include "chip8.h"
+
+namespace {
+
+// function-local, so it exists before any generated file's initializer
+std::vector<const AotProgram*>& registry() {
+    static std::vector<const AotProgram*> programs;
+    return programs;
+}
+
+} // namespace
+
+bool register_aot_program(const AotProgram& program) {
+    registry().push_back(&program);
+    return true;
+}
+
+const AotProgram* find_aot_program(uint64_t rom_hash, QuirkProfile quirks) {
+    for (const AotProgram* program : registry()) {
+        if (program->rom_hash == rom_hash && program->quirks == quirks) {
+            return program;
+        }
+    }
+    return nullptr;
+}
+
+// The compiler never emits overlapping blocks, so each byte has at most
+// one owner and a write drops at most one block. The tables cover the code
+// size of the profile the blocks were compiled for, which is what the
+// generated dispatcher masks pc with.
+Aot::Aot(const AotProgram& program, const Chip8& chip8)
+    : program_(program),
+      entries_(code_size_for(QUIRK_PROFILES[program.quirks]), nullptr),
+      owners_(code_size_for(QUIRK_PROFILES[program.quirks]), nullptr) {
+    for (size_t i = 0; i < program_.block_count; ++i) {
+        const AotBlock& block = program_.blocks[i];
+        for (size_t byte = 0; byte < 2u * block.length; ++byte) {
+            owners_[block.address + byte] = &block;
+        }
+    }
+    flush(chip8);
+}
+
+void Aot::flush(const Chip8& chip8) {
+    for (size_t i = 0; i < program_.block_count; ++i) {
+        const AotBlock& block = program_.blocks[i];
+        const uint8_t* compiled = program_.image + (block.address - PROGRAM_START);
+        const bool intact = chip8.memory.matches(block.address, compiled, 2u * block.length);
+        entries_[block.address] = intact ? &block : nullptr;
+    }
+}
+
+void Aot::invalidate(uint16_t address) {
+    address &= MEM_SIZE - 1;
+    if (address >= owners_.size()) {
+        return;
+    }
+    if (const AotBlock* block = owners_[address]) {
+        entries_[block->address] = nullptr;
+    }
+}
+
+void Aot::run(Chip8& chip8, int count) {
+    int remaining = count;
+    while (remaining > 0) {
+        const int left = program_.run(chip8, remaining, entries_.data());
+        chip8.cycles += remaining - left;
+        remaining = left;
+        if (remaining > 0) {
+            // not compiled, rewritten, or not enough budget left for the block
+            chip8.interpret(1);
+            --remaining;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef AOT_H
+#define AOT_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "quirks.h"
+
+struct Chip8;
+
+// Ahead-of-time compiled ROMs. tools/chip8_aot.cpp turns a ROM into a C++
+// file with one function per basic block; linking that file in registers
+// an AotProgram for the ROM. Blocks only cover code the compiler could see
+// and execute like the interpreter would; everything else - code reached
+// only through BNNN, and any block whose bytes have been written since -
+// runs through Chip8::interpret(), as does a block that doesn't fit in
+// what is left of the batch.
+
+struct AotBlock {
+    uint16_t address;
+    uint16_t length;    // instructions, each counted as one cycle
+};
+
+// The generated dispatcher: runs blocks from chip8.pc for as long as the
+// next one is live (live[pc] points at it) and fits in `budget`, and
+// returns the budget left. pc is left wherever it stopped.
+using AotRunFn = int (*)(Chip8& chip8, int budget, const AotBlock* const* live);
+
+struct AotProgram {
+    const char* name;
+    uint64_t rom_hash;       // hash_rom() of the ROM it was compiled from
+    const uint8_t* image;    // that ROM, loaded at PROGRAM_START
+    size_t image_size;
+    const AotBlock* blocks;
+    size_t block_count;
+    AotRunFn run;
+    QuirkProfile quirks;     // the profile the blocks were compiled for
+};
+
+// Generated files call this from a static initializer.
+bool register_aot_program(const AotProgram& program);
+// the linked-in program for a loaded ROM under a quirk profile, null if
+// there is none
+const AotProgram* find_aot_program(uint64_t rom_hash, QuirkProfile quirks);
+
+class Aot {
+public:
+    Aot(const AotProgram& program, const Chip8& chip8);
+
+    const AotProgram& program() const { return program_; }
+
+    // executes exactly `count` instructions
+    void run(Chip8& chip8, int count);
+
+    // memory at `address` changed; the block compiled from it is dropped
+    void invalidate(uint16_t address);
+    // memory may have changed anywhere: keep the blocks whose code still
+    // matches the ROM
+    void flush(const Chip8& chip8);
+
+private:
+    const AotProgram& program_;
+    std::vector<const AotBlock*> entries_;  // live block per address
+    std::vector<const AotBlock*> owners_;   // block compiled from each byte
+};
+
+#endif // AOT_H
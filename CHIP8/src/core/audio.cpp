@@ -0,0 +1,66 @@
+#include "audio.h"
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t PATTERN_BITS = AUDIO_PATTERN_SIZE * 8;
+constexpr uint32_t PHASE_MASK = (PATTERN_BITS << 16) - 1;
+// a square wave at full scale is harsh; a quarter of it is plenty
+constexpr int16_t AMPLITUDE = 8000;
+
+// XO-CHIP: 4000 pattern bits per second at pitch 64, an octave per 48 steps
+uint32_t step_for(uint8_t pitch) {
+    const double rate = 4000.0 * std::exp2((pitch - 64) / 48.0);
+    return static_cast<uint32_t>(rate * 65536.0 / AudioSynth::SAMPLE_RATE);
+}
+
+} // namespace
+
+void AudioSynth::update(const Chip8& chip8) {
+    Sound& sound = sound_.back();
+    sound.timer = chip8.sound_timer;
+    sound.cut = false;
+    sound.pitch = chip8.pitch;
+    sound.pattern = chip8.audio_pattern;
+    sound_.publish();
+}
+
+void AudioSynth::silence() {
+    Sound& sound = sound_.back();
+    sound.timer = 0;
+    sound.cut = true;
+    sound_.publish();
+}
+
+void AudioSynth::fill(int16_t* out, size_t count) {
+    if (sound_.update()) {
+        const Sound& sound = sound_.front();
+        if (sound.cut) {
+            remaining_ = 0;
+            playing_.timer = 0;
+        } else {
+            // a timer that went up was written by the ROM; one that is more
+            // than a tick away from the count here was too
+            const uint32_t target = sound.timer * SAMPLES_PER_TICK;
+            if (sound.timer > playing_.timer || target > remaining_ + SAMPLES_PER_TICK ||
+                remaining_ > target + SAMPLES_PER_TICK) {
+                remaining_ = target;
+            }
+            if (sound.pitch != playing_.pitch || !step_) {
+                step_ = step_for(sound.pitch);
+            }
+            playing_ = sound;
+        }
+    }
+
+    size_t i = 0;
+    for (; i < count && remaining_; ++i, --remaining_) {
+        const uint32_t bit = phase_ >> 16;
+        const bool high = (playing_.pattern[bit / 8] >> (7 - bit % 8)) & 1;
+        out[i] = high ? AMPLITUDE : -AMPLITUDE;
+        phase_ = (phase_ + step_) & PHASE_MASK;
+    }
+    for (; i < count; ++i) {
+        out[i] = 0;
+    }
+}
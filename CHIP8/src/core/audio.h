@@ -0,0 +1,48 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+#include "chip8.h"
+#include "triple_buffer.h"
+
+// The beeper as a stream of samples, made as the sound device asks for them.
+//
+// The emulation side hands over the machine's sound state after every slice
+// (sound_timer, pitch, pattern) through a triple buffer; the audio side
+// plays the pattern for exactly sound_timer / 60 seconds' worth of samples,
+// counting them down itself. It only takes the timer over again when the
+// ROM wrote ST (the timer went up, or the two disagree by more than a
+// tick), so a beep starts on the next buffer and is as long as the ROM
+// asked for no matter how the slices and the device's buffers line up.
+class AudioSynth {
+public:
+    static constexpr uint32_t SAMPLE_RATE = 44100;
+    static constexpr uint32_t SAMPLES_PER_TICK = SAMPLE_RATE / 60;
+    // what fill() is asked for at a time; together with the device's second
+    // buffer this bounds the output latency to about 12-24 ms
+    static constexpr uint32_t BUFFER_SAMPLES = 512;
+
+    // emulation thread
+    void update(const Chip8& chip8);
+    // cut the tone now, e.g. while rewinding
+    void silence();
+
+    // audio thread: `count` signed 16-bit mono samples
+    void fill(int16_t* out, size_t count);
+
+private:
+    struct Sound {
+        uint8_t timer = 0;
+        bool cut = false;
+        uint8_t pitch = DEFAULT_PITCH;
+        std::array<uint8_t, AUDIO_PATTERN_SIZE> pattern = DEFAULT_AUDIO_PATTERN;
+    };
+
+    TripleBuffer<Sound> sound_;
+
+    // audio thread only
+    Sound playing_{};
+    uint32_t remaining_ = 0;   // samples of tone left
+    uint32_t phase_ = 0;       // position in the pattern, 16.16 bits
+    uint32_t step_ = 0;        // pattern bits per sample, 16.16
+};
+
+#endif // AUDIO_H
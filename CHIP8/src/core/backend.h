@@ -0,0 +1,21 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+#include "chip8.h"
+
+// Where a machine's video, audio and input go. The core never talks to a
+// window or sound device itself; a frontend plugs one of these in.
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    // copy current key state into chip8.keypad
+    virtual void poll_input(Chip8& chip8) = 0;
+    // show chip8.screen
+    virtual void present(const Chip8& chip8) = 0;
+    // the beeper: sound_timer gates it, the XO-CHIP pattern and pitch say
+    // what it plays
+    virtual void set_sound(const Chip8& chip8) = 0;
+    virtual bool should_quit() { return false; }
+};
+
+#endif // BACKEND_H
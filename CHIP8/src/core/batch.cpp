@@ -0,0 +1,540 @@
+#include "batch.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CHIP8_BATCH_AVX2
+#include <immintrin.h>
+// only the lockstep kernels are built for AVX2; the rest of the file has
+// to run anywhere
+#define AVX2_FN __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+constexpr size_t VECTOR_LANES = 32;
+// smaller groups step lane by lane; a lockstep op walks every vector
+constexpr size_t MIN_LOCKSTEP_LANES = 4;
+// Once lanes have scattered this badly (groups per step > lanes / this),
+// grouping costs more than it saves; step lane by lane for a while and
+// then look again.
+constexpr size_t SCATTERED_GROUP_SIZE = 4;
+constexpr int SCATTERED_STEPS = 256;
+
+// instructions run_group() can run for a whole group at once; not the
+// skips where a skip over F000 NNNN takes four bytes
+bool lockstep_kind(OpKind kind, const Quirks& quirks) {
+    switch (kind) {
+        case OP_SE_VX_NN: case OP_SNE_VX_NN: case OP_SE_VX_VY: case OP_SNE_VX_VY:
+            return !quirks.long_skips;
+        case OP_SYS: case OP_JP:
+        case OP_LD_VX_NN: case OP_ADD_VX_NN:
+        case OP_LD_VX_VY: case OP_OR_VX_VY: case OP_AND_VX_VY: case OP_XOR_VX_VY:
+        case OP_ADD_VX_VY: case OP_SUB: case OP_SHR: case OP_SUBN: case OP_SHL:
+        case OP_LD_I: case OP_ADD_I_VX: case OP_LD_F_VX:
+        case OP_LD_VX_DT: case OP_LD_DT_VX: case OP_LD_ST_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#ifdef CHIP8_BATCH_AVX2
+
+AVX2_FN inline __m256i load(const void* p) {
+    return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+}
+
+AVX2_FN inline void store(void* p, __m256i value) {
+    _mm256_storeu_si256(static_cast<__m256i*>(p), value);
+}
+
+// a byte mask's lanes 0-15 / 16-31 as 16-bit masks
+AVX2_FN inline __m256i widen_lo(__m256i mask) {
+    return _mm256_cvtepi8_epi16(_mm256_castsi256_si128(mask));
+}
+
+AVX2_FN inline __m256i widen_hi(__m256i mask) {
+    return _mm256_cvtepi8_epi16(_mm256_extracti128_si256(mask, 1));
+}
+
+// two 16-bit masks (lanes 0-15, 16-31) back into one byte mask; packs
+// works per 128-bit half, the permute puts the quarters back in order
+AVX2_FN inline __m256i narrow(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+}
+
+// bytes of `value` where `mask` is set, `old` elsewhere
+AVX2_FN inline __m256i select(__m256i mask, __m256i value, __m256i old) {
+    return _mm256_blendv_epi8(old, value, mask);
+}
+
+#endif
+
+} // namespace
+
+Batch::Batch(const Chip8& prototype, size_t lanes)
+    : lanes_(lanes),
+      stride_((lanes + VECTOR_LANES - 1) / VECTOR_LANES * VECTOR_LANES),
+      cycles_(prototype.cycles),
+      quirks_(QUIRK_PROFILES[prototype.quirks]),
+      v_(NUM_REGISTERS * stride_),
+      pc_(stride_, prototype.pc),
+      i_(stride_, prototype.i_reg),
+      delay_(stride_, prototype.delay_timer),
+      sound_(stride_, prototype.sound_timer),
+      pending_(stride_),
+      group_(stride_),
+      keys_(stride_),
+      code_(prototype.memory),
+      shared_(prototype.code_size()),
+      machines_(lanes) {
+    for (size_t r = 0; r < NUM_REGISTERS; ++r) {
+        std::fill_n(&v_[r * stride_], stride_, prototype.v_regs[r]);
+    }
+    for (size_t key = 0; key < NUM_KEYS; ++key) {
+        keys_[0] |= prototype.keypad[key] << key;
+    }
+    std::fill_n(keys_.begin(), lanes_, keys_[0]);
+    // everything capture_state() covers but what lives in the arrays above
+    // (registers, pc, I, timers, cycles); memory as shared pages, so a lane
+    // costs no memory until it writes
+    for (Chip8& machine : machines_) {
+        machine.memory = prototype.memory;
+        machine.screen = prototype.screen;
+        machine.stack = prototype.stack;
+        machine.sp = prototype.sp;
+        machine.keypad = prototype.keypad;
+        machine.rng_seed = prototype.rng_seed;
+        machine.rng_state = prototype.rng_state;
+        machine.pitch = prototype.pitch;
+        machine.audio_pattern = prototype.audio_pattern;
+        machine.planes = prototype.planes;
+        machine.rpl_flags = prototype.rpl_flags;
+        machine.quirks = prototype.quirks;
+    }
+    const size_t mask = shared_.size() - 1;
+    for (size_t at = 0; at < shared_.size(); ++at) {
+        shared_[at] = decode_opcode((prototype.memory[at] << 8) | prototype.memory[(at + 1) & mask]);
+    }
+}
+
+bool Batch::simd_available() {
+#ifdef CHIP8_BATCH_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+void Batch::seed_random(size_t lane, uint64_t seed) {
+    machines_[lane].seed_random(seed);
+}
+
+void Batch::set_keys(size_t lane, uint16_t keys) {
+    keys_[lane] = keys;
+    for (size_t key = 0; key < NUM_KEYS; ++key) {
+        machines_[lane].keypad[key] = (keys >> key) & 1;
+    }
+}
+
+void Batch::update_timers() {
+    for (size_t lane = 0; lane < lanes_; ++lane) {
+        delay_[lane] -= delay_[lane] > 0;
+        sound_[lane] -= sound_[lane] > 0;
+    }
+}
+
+const Chip8& Batch::lane(size_t lane) {
+    return load_lane(lane);
+}
+
+void Batch::run(int count) {
+    const bool simd = simd_available() && lanes_ >= MIN_LOCKSTEP_LANES;
+    while (count > 0) {
+        if (simd && scattered_steps_ == 0) {
+            step();
+            --count;
+            continue;
+        }
+        const int chunk = simd ? std::min(count, scattered_steps_) : count;
+        for (size_t lane = 0; lane < lanes_; ++lane) {
+            Chip8& c = load_lane(lane);
+            c.interpret(chunk);
+            store_lane(lane);
+        }
+        if (simd) {
+            scattered_steps_ -= chunk;
+            // only grouping looks at shared_, so it's brought up to date
+            // just before that
+            if (scattered_steps_ == 0) {
+                mark_changed_code();
+            }
+        }
+        cycles_ += chunk;
+        instructions_ += lanes_ * chunk;
+        count -= chunk;
+    }
+}
+
+// One instruction on every lane: take the first lane not run yet, run every
+// lane at the same pc with it, repeat.
+void Batch::step() {
+    std::fill_n(pending_.begin(), lanes_, 0xFF);
+    size_t groups = 0;
+    for (size_t first = 0;; ++first) {
+        while (first < lanes_ && !pending_[first]) {
+            ++first;
+        }
+        if (first == lanes_) {
+            break;
+        }
+        ++groups;
+        const size_t members = collect_group(pc_[first], first);
+        const uint16_t pc = pc_[first] & (shared_.size() - 1); // where it wraps to
+        const DecodedOp& op = shared_[pc];
+        if (members >= MIN_LOCKSTEP_LANES) {
+            if (lockstep_kind(op.kind, quirks_)) {
+                run_group(op, pc);
+                lockstep_instructions_ += members;
+                continue;
+            }
+            if ((op.kind == OP_LD_VX_K && !group_has_keys(first)) || op.kind == OP_EXIT) {
+                lockstep_instructions_ += members; // all still waiting or stopped, pc stays
+                continue;
+            }
+        }
+        if (op.kind != OP_UNDECODED && run_group_lanes(op, pc, first)) {
+            lockstep_instructions_ += members;
+            continue;
+        }
+        for (size_t lane = first; lane < lanes_; ++lane) {
+            if (group_[lane]) {
+                step_lane(lane);
+            }
+        }
+    }
+    if (groups * SCATTERED_GROUP_SIZE > lanes_) {
+        scattered_steps_ = SCATTERED_STEPS;
+    }
+    ++cycles_;
+    instructions_ += lanes_;
+}
+
+// The instructions that need a lane's own machine but only a register or
+// two of it, run for the group a lane at a time without loading the rest;
+// same results as their handlers in opcodes.cpp. False for anything else.
+bool Batch::run_group_lanes(const DecodedOp& op, uint16_t pc, size_t first) {
+    const uint16_t next = pc + 2;
+    uint8_t* const vx = &v_[op.x * stride_];
+    uint8_t* const vy = &v_[op.y * stride_];
+    uint8_t* const vf = &v_[0xF * stride_];
+    switch (op.kind) {
+        case OP_CLS: case OP_CALL: case OP_RET: case OP_RND: case OP_DRW:
+            break;
+        default:
+            return false;
+    }
+    for (size_t lane = first; lane < lanes_; ++lane) {
+        if (!group_[lane]) {
+            continue;
+        }
+        Chip8& c = machines_[lane];
+        pc_[lane] = next;
+        switch (op.kind) {
+            case OP_CLS:
+                c.clear_screen();
+                break;
+            case OP_CALL:
+                if (c.sp < STACK_SIZE) {
+                    c.stack[c.sp++] = next;
+                    pc_[lane] = op.nnn;
+                }
+                break;
+            case OP_RET:
+                if (c.sp > 0) {
+                    pc_[lane] = c.stack[--c.sp];
+                }
+                break;
+            case OP_RND:
+                vx[lane] = c.next_random() & op.nn;
+                break;
+            default: // OP_DRW
+                c.i_reg = i_[lane];
+                c.draw_sprite(vx[lane], vy[lane], op.n);
+                vf[lane] = c.v_regs[0xF];
+                break;
+        }
+    }
+    return true;
+}
+
+bool Batch::group_has_keys(size_t first) const {
+    for (size_t lane = first; lane < lanes_; ++lane) {
+        if (group_[lane] && keys_[lane]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Chip8& Batch::load_lane(size_t lane) {
+    Chip8& c = machines_[lane];
+    c.pc = pc_[lane];
+    c.i_reg = i_[lane];
+    c.delay_timer = delay_[lane];
+    c.sound_timer = sound_[lane];
+    for (size_t r = 0; r < NUM_REGISTERS; ++r) {
+        c.v_regs[r] = v_[r * stride_ + lane];
+    }
+    c.cycles = cycles_;
+    return c;
+}
+
+void Batch::store_lane(size_t lane) {
+    const Chip8& c = machines_[lane];
+    pc_[lane] = c.pc;
+    i_[lane] = c.i_reg;
+    delay_[lane] = c.delay_timer;
+    sound_[lane] = c.sound_timer;
+    for (size_t r = 0; r < NUM_REGISTERS; ++r) {
+        v_[r * stride_ + lane] = c.v_regs[r];
+    }
+}
+
+// Lane by lane, through the lane's own machine.
+void Batch::step_lane(size_t lane) {
+    Chip8& c = load_lane(lane);
+    const uint16_t mask = shared_.size() - 1;
+    const uint16_t at = c.pc & mask;
+    const uint16_t opcode = (c.memory[at] << 8) | c.memory[(at + 1) & mask];
+    if ((opcode & 0xF0FF) == 0xF033) {
+        mark_written(c.i_reg, 3);
+    } else if ((opcode & 0xF0FF) == 0xF055) {
+        mark_written(c.i_reg, ((opcode >> 8) & 0xF) + 1);
+    } else if ((opcode & 0xF00F) == 0x5002) {
+        const int x = (opcode >> 8) & 0xF, y = (opcode >> 4) & 0xF;
+        mark_written(c.i_reg, std::abs(x - y) + 1);
+    }
+    c.pc = at + 2;
+    c.run_opcode(opcode);
+    store_lane(lane);
+}
+
+// Lanes may now disagree about the code here (and in the instruction
+// starting one byte earlier), so nothing there runs in lockstep again.
+// Bytes past where pc wraps are never code.
+void Batch::mark_written(uint16_t address, unsigned length) {
+    const uint16_t mask = shared_.size() - 1;
+    for (unsigned k = 0; k < length; ++k) {
+        const uint16_t at = (address + k) & (MEM_SIZE - 1);
+        if (at < shared_.size()) {
+            shared_[at].kind = OP_UNDECODED;
+            shared_[(at - 1) & mask].kind = OP_UNDECODED;
+        }
+    }
+}
+
+// After lanes ran on their own: whatever they stored no longer shows, so
+// find it by comparing with the prototype's memory. Only pages a lane has
+// its own copy of can differ.
+void Batch::mark_changed_code() {
+    for (const Chip8& machine : machines_) {
+        for (size_t page = 0; page < MEMORY_PAGES; ++page) {
+            if (machine.memory.shares_page(code_, page)) {
+                continue;
+            }
+            for (size_t at = page * MEMORY_PAGE_SIZE; at < (page + 1) * MEMORY_PAGE_SIZE; ++at) {
+                if (machine.memory[at] != code_[at]) {
+                    mark_written(at, 1);
+                }
+            }
+        }
+    }
+}
+
+#ifdef CHIP8_BATCH_AVX2
+
+// group_ = the pending lanes at `pc`, which stop being pending. Lanes
+// before `first` are known not to be pending.
+AVX2_FN size_t Batch::collect_group(uint16_t pc, size_t first) {
+    const __m256i wanted = _mm256_set1_epi16(static_cast<short>(pc));
+    size_t members = 0;
+    const size_t start = first / VECTOR_LANES * VECTOR_LANES;
+    std::fill(group_.begin(), group_.begin() + start, 0);
+    for (size_t base = start; base < stride_; base += VECTOR_LANES) {
+        const __m256i pending = load(&pending_[base]);
+        const __m256i at_pc = narrow(_mm256_cmpeq_epi16(load(&pc_[base]), wanted),
+                                     _mm256_cmpeq_epi16(load(&pc_[base + 16]), wanted));
+        const __m256i group = _mm256_and_si256(pending, at_pc);
+        store(&group_[base], group);
+        store(&pending_[base], _mm256_andnot_si256(group, pending));
+        members += std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(group)));
+    }
+    return members;
+}
+
+// `op` at `pc` on every lane in group_, 32 lanes at a time, with the
+// results blended in only where the group mask is set.
+AVX2_FN void Batch::run_group(const DecodedOp& op, uint16_t pc) {
+    uint8_t* const vx = &v_[op.x * stride_];
+    uint8_t* const vy = &v_[op.y * stride_];
+    uint8_t* const vf = &v_[0xF * stride_];
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i nn = _mm256_set1_epi8(static_cast<char>(op.nn));
+    const __m256i flag_bit = _mm256_set1_epi8(1);
+    const __m256i next = _mm256_set1_epi16(static_cast<short>(pc + 2));
+    const __m256i skip_by = _mm256_set1_epi16(2);
+
+    for (size_t base = 0; base < stride_; base += VECTOR_LANES) {
+        const __m256i mask = load(&group_[base]);
+        if (_mm256_testz_si256(mask, mask)) {
+            continue;
+        }
+        const __m256i mask_lo = widen_lo(mask), mask_hi = widen_hi(mask);
+        __m256i skip = _mm256_setzero_si256();
+        // result for Vx and, for the 8XYN that set it, VF (0/1 per byte)
+        __m256i result = _mm256_setzero_si256();
+        __m256i flag = _mm256_setzero_si256();
+        bool writes_vx = true, writes_vf = false;
+
+        switch (op.kind) {
+            case OP_SE_VX_NN:
+                skip = _mm256_cmpeq_epi8(load(vx + base), nn);
+                writes_vx = false;
+                break;
+            case OP_SNE_VX_NN:
+                skip = _mm256_xor_si256(_mm256_cmpeq_epi8(load(vx + base), nn), ones);
+                writes_vx = false;
+                break;
+            case OP_SE_VX_VY:
+                skip = _mm256_cmpeq_epi8(load(vx + base), load(vy + base));
+                writes_vx = false;
+                break;
+            case OP_SNE_VX_VY:
+                skip = _mm256_xor_si256(_mm256_cmpeq_epi8(load(vx + base), load(vy + base)), ones);
+                writes_vx = false;
+                break;
+            case OP_LD_VX_NN: result = nn; break;
+            case OP_ADD_VX_NN: result = _mm256_add_epi8(load(vx + base), nn); break;
+            case OP_LD_VX_VY: result = load(vy + base); break;
+            case OP_OR_VX_VY:
+                result = _mm256_or_si256(load(vx + base), load(vy + base));
+                writes_vf = quirks_.logic_resets_vf; // flag stays 0
+                break;
+            case OP_AND_VX_VY:
+                result = _mm256_and_si256(load(vx + base), load(vy + base));
+                writes_vf = quirks_.logic_resets_vf; // flag stays 0
+                break;
+            case OP_XOR_VX_VY:
+                result = _mm256_xor_si256(load(vx + base), load(vy + base));
+                writes_vf = quirks_.logic_resets_vf; // flag stays 0
+                break;
+            case OP_ADD_VX_VY: {
+                const __m256i x = load(vx + base), y = load(vy + base);
+                result = _mm256_add_epi8(x, y);
+                // carried = the saturating sum differs from the wrapping one
+                flag = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_adds_epu8(x, y), result), flag_bit);
+                writes_vf = true;
+                break;
+            }
+            case OP_SUB: case OP_SUBN: {
+                const __m256i x = load(vx + base), y = load(vy + base);
+                const __m256i from = op.kind == OP_SUB ? x : y, by = op.kind == OP_SUB ? y : x;
+                result = _mm256_sub_epi8(from, by);
+                flag = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(from, by), from), flag_bit);
+                writes_vf = true;
+                break;
+            }
+            case OP_SHR: {
+                const __m256i y = load(quirks_.shift_vx ? vx + base : vy + base);
+                result = _mm256_and_si256(_mm256_srli_epi16(y, 1), _mm256_set1_epi8(0x7F));
+                flag = _mm256_and_si256(y, flag_bit);
+                writes_vf = true;
+                break;
+            }
+            case OP_SHL: {
+                const __m256i y = load(quirks_.shift_vx ? vx + base : vy + base);
+                result = _mm256_add_epi8(y, y);
+                flag = _mm256_and_si256(_mm256_srli_epi16(y, 7), flag_bit);
+                writes_vf = true;
+                break;
+            }
+            case OP_LD_VX_DT: result = load(&delay_[base]); break;
+            case OP_LD_DT_VX:
+                store(&delay_[base], select(mask, load(vx + base), load(&delay_[base])));
+                writes_vx = false;
+                break;
+            case OP_LD_ST_VX:
+                store(&sound_[base], select(mask, load(vx + base), load(&sound_[base])));
+                writes_vx = false;
+                break;
+            case OP_LD_I: {
+                const __m256i address = _mm256_set1_epi16(static_cast<short>(op.nnn));
+                store(&i_[base], select(mask_lo, address, load(&i_[base])));
+                store(&i_[base + 16], select(mask_hi, address, load(&i_[base + 16])));
+                writes_vx = false;
+                break;
+            }
+            case OP_ADD_I_VX: case OP_LD_F_VX: {
+                const __m256i x = load(vx + base);
+                const __m256i x_lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(x));
+                const __m256i x_hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1));
+                __m256i i_lo, i_hi;
+                if (op.kind == OP_ADD_I_VX) {
+                    i_lo = _mm256_add_epi16(load(&i_[base]), x_lo);
+                    i_hi = _mm256_add_epi16(load(&i_[base + 16]), x_hi);
+                    // VF = I left the 12-bit address space
+                    const __m256i high = _mm256_set1_epi16(static_cast<short>(0xF000));
+                    const __m256i zero = _mm256_setzero_si256();
+                    const __m256i in_lo = _mm256_cmpeq_epi16(_mm256_and_si256(i_lo, high), zero);
+                    const __m256i in_hi = _mm256_cmpeq_epi16(_mm256_and_si256(i_hi, high), zero);
+                    flag = _mm256_andnot_si256(narrow(in_lo, in_hi), flag_bit);
+                    writes_vf = quirks_.index_overflow_vf;
+                } else {
+                    const __m256i font = _mm256_set1_epi16(FONTSET_START_ADDRESS);
+                    const __m256i glyph = _mm256_set1_epi16(5);
+                    i_lo = _mm256_add_epi16(font, _mm256_mullo_epi16(x_lo, glyph));
+                    i_hi = _mm256_add_epi16(font, _mm256_mullo_epi16(x_hi, glyph));
+                }
+                store(&i_[base], select(mask_lo, i_lo, load(&i_[base])));
+                store(&i_[base + 16], select(mask_hi, i_hi, load(&i_[base + 16])));
+                writes_vx = false;
+                break;
+            }
+            default: // OP_SYS, OP_JP
+                writes_vx = false;
+                break;
+        }
+
+        // Vx before VF, so VF wins when x is F, as in the interpreter
+        if (writes_vx) {
+            store(vx + base, select(mask, result, load(vx + base)));
+        }
+        if (writes_vf) {
+            store(vf + base, select(mask, flag, load(vf + base)));
+        }
+
+        __m256i pc_lo, pc_hi;
+        if (op.kind == OP_JP) {
+            pc_lo = pc_hi = _mm256_set1_epi16(static_cast<short>(op.nnn));
+        } else {
+            pc_lo = _mm256_add_epi16(next, _mm256_and_si256(widen_lo(skip), skip_by));
+            pc_hi = _mm256_add_epi16(next, _mm256_and_si256(widen_hi(skip), skip_by));
+        }
+        store(&pc_[base], select(mask_lo, pc_lo, load(&pc_[base])));
+        store(&pc_[base + 16], select(mask_hi, pc_hi, load(&pc_[base + 16])));
+    }
+}
+
+#else
+
+size_t Batch::collect_group(uint16_t, size_t) {
+    return 0;
+}
+
+void Batch::run_group(const DecodedOp&, uint16_t) {}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.h"
+
+// Many copies of one machine stepped together, for search and fuzzing runs
+// that play the same ROM with different seeds or keys. The registers, pc, I
+// and the timers live here as one array per field with a slot ("lane") per
+// machine; memory, screen, stack, keys and the random generator stay in an
+// ordinary Chip8 per lane.
+//
+// Every step, lanes are grouped by pc. A group of lanes at the same address
+// whose code no lane has written to runs its instruction once for the
+// whole group, 32 lanes per AVX2 operation. That covers the register,
+// timer, I, skip and jump instructions (and FX0A while no key is down).
+// Calls, returns, draws and CXNN go through the group a lane at a time,
+// touching only the fields they use. Everything else (memory, keys, code
+// some lane has written) and any group too small to be worth a vector op
+// runs lane by lane through Chip8::run_opcode(). Once the lanes have
+// scattered over too many addresses, each runs a stretch on its own
+// through Chip8::interpret() before they're grouped again; hosts without
+// AVX2 only ever do that. Either way each lane ends up exactly where
+// Chip8::interpret() would have left it.
+class Batch {
+public:
+    // `lanes` copies of `prototype`'s state (what capture_state() covers)
+    Batch(const Chip8& prototype, size_t lanes);
+
+    size_t lanes() const { return lanes_; }
+    // false = every instruction runs lane by lane
+    static bool simd_available();
+
+    // per-lane inputs
+    void seed_random(size_t lane, uint64_t seed);
+    void set_keys(size_t lane, uint16_t keys);   // bit n = key n down
+
+    // every lane executes exactly `count` instructions
+    void run(int count);
+    // one 60 Hz tick on every lane
+    void update_timers();
+
+    // the lane as an ordinary machine, registers included; good until the
+    // next run()
+    const Chip8& lane(size_t lane);
+
+    // instructions executed since construction, summed over lanes, and how
+    // many of those ran in lockstep (decoded once for a group of lanes)
+    uint64_t instructions() const { return instructions_; }
+    uint64_t lockstep_instructions() const { return lockstep_instructions_; }
+
+private:
+    void step();
+    size_t collect_group(uint16_t pc, size_t first);
+    void run_group(const DecodedOp& op, uint16_t pc);
+    bool run_group_lanes(const DecodedOp& op, uint16_t pc, size_t first);
+    bool group_has_keys(size_t first) const;
+    void step_lane(size_t lane);
+    // the lane's registers into its machine and back
+    Chip8& load_lane(size_t lane);
+    void store_lane(size_t lane);
+    void mark_written(uint16_t address, unsigned length);
+    void mark_changed_code();
+
+    size_t lanes_;
+    size_t stride_;    // lanes_ rounded up to whole vectors
+    uint64_t cycles_ = 0;
+    uint64_t instructions_ = 0;
+    uint64_t lockstep_instructions_ = 0;
+    int scattered_steps_ = 0;   // left to run lane by lane before grouping again
+    Quirks quirks_;             // the prototype's profile, which every lane runs
+
+    // one array per register, `stride_` lanes each
+    std::vector<uint8_t> v_;       // V0's lanes, then V1's, ...
+    std::vector<uint16_t> pc_;
+    std::vector<uint16_t> i_;
+    std::vector<uint8_t> delay_;
+    std::vector<uint8_t> sound_;
+    // 0xFF per lane still to run this step / in the group being run
+    std::vector<uint8_t> pending_;
+    std::vector<uint8_t> group_;
+    std::vector<uint16_t> keys_;   // bit n = key n down, as on the lane's keypad
+
+    // the prototype's memory, which every lane starts from (and shares
+    // until it writes)
+    PagedMemory code_;
+
+    // the prototype's code, decoded once; OP_UNDECODED where some lane has
+    // stored since, so each lane has to read its own
+    std::vector<DecodedOp> shared_;
+    std::vector<Chip8> machines_;
+};
+
+#endif // BATCH_H
@@ -0,0 +1,230 @@
+#include "capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+template <typename T>
+void put(uint8_t*& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(*in++) << (8 * i);
+    }
+    return value;
+}
+
+// Works a word (64 pixels) at a time where a word is one color all the way,
+// which is most of most screens.
+void encode_runs(const Framebuffer& screen, std::vector<uint8_t>& out) {
+    out.clear();
+    uint8_t color = pixel_at(screen, 0, 0);
+    size_t run = 0;
+    auto add = [&](uint8_t pixel, size_t count) {
+        if (pixel != color) {
+            for (; run > 0; run -= std::min(run, CAPTURE_MAX_RUN)) {
+                out.push_back(static_cast<uint8_t>((std::min(run, CAPTURE_MAX_RUN) - 1) << 2 | color));
+            }
+            color = pixel;
+        }
+        run += count;
+    };
+    for (size_t y = 0; y < screen.height(); ++y) {
+        for (size_t word = 0; word < screen.width() / 64; ++word) {
+            const uint64_t low = screen.planes[0][y][word];
+            const uint64_t high = screen.planes[1][y][word];
+            if ((low == 0 || low == ~uint64_t{0}) && (high == 0 || high == ~uint64_t{0})) {
+                add(static_cast<uint8_t>((low & 1) | (high & 1) << 1), 64);
+                continue;
+            }
+            for (size_t x = word * 64; x < word * 64 + 64; ++x) {
+                add(pixel_at(screen, x, y), 1);
+            }
+        }
+    }
+    add(static_cast<uint8_t>(color ^ 1), 0); // flush
+}
+
+// a lores pixel becomes 2x2, so every frame down the pipe is the same size
+void encode_rgb(const Framebuffer& screen, std::vector<uint8_t>& out) {
+    out.resize(SWIDTH * SHEIGHT * 3);
+    const size_t scale = SWIDTH / screen.width();
+    uint8_t* rgb = out.data();
+    for (size_t y = 0; y < SHEIGHT; ++y) {
+        for (size_t x = 0; x < SWIDTH; ++x) {
+            std::memcpy(rgb, CAPTURE_PALETTE[pixel_at(screen, x / scale, y / scale)], 3);
+            rgb += 3;
+        }
+    }
+}
+
+} // namespace
+
+FrameCapture::FrameCapture(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring_.resize(size);
+    mask_ = size - 1;
+}
+
+FrameCapture::~FrameCapture() {
+    stop();
+}
+
+bool FrameCapture::start(const std::string& target, bool changed_only) {
+    stop();
+    piped_ = !target.empty() && target[0] == '|';
+    file_ = piped_ ? popen(target.c_str() + 1, "w") : std::fopen(target.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Failed to open capture > " << target << std::endl;
+        return false;
+    }
+    if (!piped_) {
+        uint8_t header[8];
+        uint8_t* out = header;
+        for (char c : CAPTURE_MAGIC) {
+            put(out, static_cast<uint8_t>(c));
+        }
+        put(out, CAPTURE_VERSION);
+        std::fwrite(header, 1, sizeof(header), file_);
+    }
+    changed_only_ = changed_only;
+    head_ = 0;
+    tail_ = 0;
+    written_ = 0;
+    frames_seen_ = 0;
+    stalls_ = 0;
+
+    running_ = true;
+    writer_ = std::thread([this] {
+        while (running_.load(std::memory_order_acquire)) {
+            if (!drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drain();
+        std::fflush(file_);
+    });
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (writer_.joinable()) {
+        running_.store(false, std::memory_order_release);
+        writer_.join();
+    }
+    if (file_) {
+        if (piped_) {
+            pclose(file_);
+        } else {
+            std::fclose(file_);
+        }
+        file_ = nullptr;
+    }
+}
+
+void FrameCapture::wait_for_slot(uint64_t head) {
+    ++stalls_;
+    while (head - tail_.load(std::memory_order_acquire) == ring_.size()) {
+        std::this_thread::yield();
+    }
+}
+
+// writer thread only; false if there was nothing to write
+bool FrameCapture::drain() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    while (tail != head) {
+        write_frame(ring_[tail & mask_]);
+        tail_.store(++tail, std::memory_order_release);
+        written_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void FrameCapture::write_frame(const Slot& slot) {
+    if (piped_) {
+        encode_rgb(slot.screen, encoded_);
+        std::fwrite(encoded_.data(), 1, encoded_.size(), file_);
+        return;
+    }
+    encode_runs(slot.screen, encoded_);
+    uint8_t header[sizeof(CaptureFrameHeader)];
+    uint8_t* out = header;
+    put(out, slot.cycle);
+    put(out, slot.frame);
+    put(out, static_cast<uint16_t>(slot.screen.width()));
+    put(out, static_cast<uint16_t>(slot.screen.height()));
+    put(out, static_cast<uint32_t>(encoded_.size()));
+    std::fwrite(header, 1, sizeof(header), file_);
+    std::fwrite(encoded_.data(), 1, encoded_.size(), file_);
+}
+
+CaptureReader::~CaptureReader() {
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool CaptureReader::open(const std::string& filepath) {
+    file_ = std::fopen(filepath.c_str(), "rb");
+    if (!file_) {
+        std::cerr << "Failed to open capture > " << filepath << std::endl;
+        return false;
+    }
+    uint8_t header[8];
+    if (std::fread(header, 1, sizeof(header), file_) != sizeof(header)
+        || std::memcmp(header, CAPTURE_MAGIC, 4) != 0) {
+        std::cerr << "Not a CHIP-8 capture > " << filepath << std::endl;
+        return false;
+    }
+    const uint8_t* in = header + 4;
+    const uint32_t version = get<uint32_t>(in);
+    if (version != CAPTURE_VERSION) {
+        std::cerr << "Unsupported capture version " << version << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureReader::next(CapturedFrame& frame) {
+    uint8_t bytes[sizeof(CaptureFrameHeader)];
+    if (std::fread(bytes, sizeof(bytes), 1, file_) != 1) {
+        return false;
+    }
+    const uint8_t* in = bytes;
+    CaptureFrameHeader& header = frame.header;
+    header.cycle = get<uint64_t>(in);
+    header.frame = get<uint64_t>(in);
+    header.width = get<uint16_t>(in);
+    header.height = get<uint16_t>(in);
+    header.size = get<uint32_t>(in);
+    encoded_.resize(header.size);
+    if (header.width == 0 || header.width > SWIDTH || header.height == 0 || header.height > SHEIGHT
+        || std::fread(encoded_.data(), 1, encoded_.size(), file_) != encoded_.size()) {
+        error_ = true;
+        return false;
+    }
+    frame.pixels.clear();
+    for (uint8_t run : encoded_) {
+        frame.pixels.insert(frame.pixels.end(), (run >> 2) + 1, run & 3);
+    }
+    if (frame.pixels.size() != size_t{header.width} * header.height) {
+        error_ = true;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,127 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+
+// A capture file is a header and then one of these per frame, followed by
+// `size` bytes of run-length coded pixels: row by row, each byte a run of
+// (byte >> 2) + 1 pixels of color byte & 3, as pixel_at() numbers them.
+// A blank screen takes 128 bytes, a busy one a few hundred. Header fields
+// are little-endian whatever the host, in the order declared.
+struct CaptureFrameHeader {
+    uint64_t cycle;    // instructions executed when the frame was presented
+    uint64_t frame;    // presented frames before this one, counting skipped ones
+    uint16_t width;
+    uint16_t height;
+    uint32_t size;
+};
+static_assert(sizeof(CaptureFrameHeader) == 24);
+
+constexpr char CAPTURE_MAGIC[4] = {'C', '8', 'F', 'C'};
+constexpr uint32_t CAPTURE_VERSION = 1;
+constexpr size_t CAPTURE_MAX_RUN = 64;
+
+// The window's palette (BLACK, GREEN, ORANGE, RAYWHITE) as RGB, for
+// anything that turns captured pixels back into an image.
+constexpr uint8_t CAPTURE_PALETTE[1 << NUM_PLANES][3] = {
+    {0, 0, 0}, {0, 228, 48}, {255, 161, 0}, {245, 245, 245}
+};
+
+// Records presented frames without slowing the machine that presents them.
+// The emulation side only copies the framebuffer into the next slot of a
+// preallocated single-producer/single-consumer ring; a background thread
+// encodes and writes. Unlike the tracer a full ring doesn't drop frames -
+// a video with holes is no use - so the producer waits for a slot and the
+// wait is counted in stalls(). In changed-only mode a frame identical to
+// the last one captured is skipped before it is copied.
+//
+// The target is either a capture file, or "|command": a pipe into that
+// command, fed raw 128x64 rgb24 frames (a lores screen doubled up) with no
+// timestamps, e.g. "|ffmpeg -f rawvideo -pixel_format rgb24 -video_size
+// 128x64 -framerate 60 -i - out.mp4".
+class FrameCapture {
+public:
+    explicit FrameCapture(size_t capacity = 256);
+    ~FrameCapture();
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool start(const std::string& target, bool changed_only = false);
+    void stop();
+
+    // from wherever frames are presented; one thread only
+    void capture(const Framebuffer& screen, uint64_t cycle) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        const uint64_t frame = frames_seen_++;
+        // the previous slot stays as it was until the producer reuses it
+        if (changed_only_ && head != 0 && ring_[(head - 1) & mask_].screen == screen) {
+            return;
+        }
+        if (head - tail_.load(std::memory_order_acquire) == ring_.size()) {
+            wait_for_slot(head);
+        }
+        Slot& slot = ring_[head & mask_];
+        slot.screen = screen;
+        slot.cycle = cycle;
+        slot.frame = frame;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t frames_written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t stalls() const { return stalls_; }
+
+private:
+    struct Slot {
+        Framebuffer screen;
+        uint64_t cycle;
+        uint64_t frame;
+    };
+
+    void wait_for_slot(uint64_t head);
+    bool drain();
+    void write_frame(const Slot& slot);
+
+    std::vector<Slot> ring_;
+    uint64_t mask_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<bool> running_{false};
+    bool changed_only_ = false;
+    bool piped_ = false;
+    uint64_t frames_seen_ = 0;  // producer only
+    uint64_t stalls_ = 0;       // producer only
+    std::vector<uint8_t> encoded_;  // writer only
+    std::FILE* file_ = nullptr;
+    std::thread writer_;
+};
+
+// One decoded frame of a capture file; pixels are pixel_at() colors, row by
+// row.
+struct CapturedFrame {
+    CaptureFrameHeader header{};
+    std::vector<uint8_t> pixels;
+};
+
+// Reads a capture file frame by frame.
+class CaptureReader {
+public:
+    ~CaptureReader();
+
+    bool open(const std::string& filepath);
+    // false at the end of the file or on a damaged frame (see error())
+    bool next(CapturedFrame& frame);
+    bool error() const { return error_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<uint8_t> encoded_;
+    bool error_ = false;
+};
+
+#endif // CAPTURE_H
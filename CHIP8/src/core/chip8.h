@@ -0,0 +1,256 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+#include <array>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+#include "aot.h"
+#include "decode.h"
+#include "jit.h"
+#include "quirks.h"
+
+class Tracer;
+class Recorder;
+class Profiler;
+class Debugger;
+
+// Constants
+constexpr size_t MEM_SIZE = 65536; // XO-CHIP's; CHIP-8 programs only see the first 4 KB
+constexpr size_t CLASSIC_MEM_SIZE = 4096;
+// How far pc reaches: all of memory under a long_code profile, otherwise
+// the classic 4 KB, wrapping back to 0. The decode cache and the
+// recompilers' per-address tables are this big.
+constexpr size_t code_size_for(const Quirks& quirks) {
+    return quirks.long_code ? MEM_SIZE : CLASSIC_MEM_SIZE;
+}
+// SUPER-CHIP/XO-CHIP hires mode; lores machines use the top-left quarter
+constexpr size_t SWIDTH = 128;
+constexpr size_t SHEIGHT = 64;
+constexpr size_t LORES_WIDTH = 64;
+constexpr size_t LORES_HEIGHT = 32;
+constexpr size_t NUM_PLANES = 2; // XO-CHIP bitplanes
+constexpr size_t NUM_REGISTERS = 16;
+constexpr size_t STACK_SIZE = 16;
+constexpr size_t NUM_KEYS = 16;
+constexpr uint16_t PROGRAM_START = 0x200;
+constexpr uint16_t FONTSET_START_ADDRESS = 0x50;
+constexpr uint8_t FONTSET_SIZE = 80;
+// SUPER-CHIP's 8x10 digits for FX30, with XO-CHIP's A-F
+constexpr uint16_t BIG_FONTSET_START_ADDRESS = 0xA0;
+constexpr uint8_t BIG_FONTSET_SIZE = 160;
+constexpr size_t NUM_RPL_FLAGS = 16; // FX75/FX85 storage
+constexpr uint64_t DEFAULT_RNG_SEED = 0xC8C8C8C8;
+// XO-CHIP audio: a 128-sample 1-bit pattern, played at
+// 4000 * 2^((pitch - 64) / 48) samples per second
+constexpr size_t AUDIO_PATTERN_SIZE = 16;
+constexpr uint8_t DEFAULT_PITCH = 64;
+// a 500 Hz square wave at the default pitch, until a ROM loads its own
+constexpr std::array<uint8_t, AUDIO_PATTERN_SIZE> DEFAULT_AUDIO_PATTERN = {
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0
+};
+
+// One bit per pixel per plane, two words per row, bit 63 of the first word
+// is the leftmost pixel. A lores screen lives in the first word of the
+// first 32 rows, so it is drawn, scrolled and hashed exactly as when that
+// was all there was; sprites XOR in and scrolls move a row at a time.
+// 2 KB with both planes.
+struct Framebuffer {
+    static constexpr size_t ROW_WORDS = SWIDTH / 64;
+    using Row = std::array<uint64_t, ROW_WORDS>;
+    using Plane = std::array<Row, SHEIGHT>;
+
+    std::array<Plane, NUM_PLANES> planes{};
+    bool hires = false;
+
+    size_t width() const { return hires ? SWIDTH : LORES_WIDTH; }
+    size_t height() const { return hires ? SHEIGHT : LORES_HEIGHT; }
+    bool operator==(const Framebuffer&) const = default;
+};
+
+// 0-3: bit n set = lit in plane n
+inline uint8_t pixel_at(const Framebuffer& fb, size_t x, size_t y) {
+    const size_t shift = 63 - x % 64;
+    return ((fb.planes[0][y][x / 64] >> shift) & 1) | ((fb.planes[1][y][x / 64] >> shift) & 1) << 1;
+}
+
+uint64_t hash_framebuffer(const Framebuffer& fb);
+
+// The address space as 256 pages of 256 bytes. A page is shared - between
+// machines, and with the font and ROM images - until a machine writes to
+// it, and only then does that machine get a copy of its own. Copying a
+// PagedMemory copies page pointers, so making a machine like another costs
+// the same however much memory it has, and a machine's own footprint is the
+// pages it has written.
+//
+// Only the classic 4 KB has a page table in the machine itself. The 240
+// pages above it are one more table, shared as a whole until the machine
+// first writes up there, so a CHIP-8 machine carries 16 pages' worth of
+// pointers and not 256.
+constexpr size_t MEMORY_PAGE_SIZE = 256;
+constexpr size_t MEMORY_PAGES = MEM_SIZE / MEMORY_PAGE_SIZE;
+constexpr size_t LOW_MEMORY_PAGES = CLASSIC_MEM_SIZE / MEMORY_PAGE_SIZE;
+
+class PagedMemory {
+public:
+    using Page = std::array<uint8_t, MEMORY_PAGE_SIZE>;
+    template <size_t N>
+    struct PageTable {
+        std::array<const uint8_t*, N> pages;
+        std::array<std::shared_ptr<Page>, N> owners;   // never written while shared
+    };
+    using HighPages = PageTable<MEMORY_PAGES - LOW_MEMORY_PAGES>;
+
+    // all zero but the font
+    PagedMemory();
+
+    uint8_t operator[](size_t address) const {
+        address &= MEM_SIZE - 1;
+        return page(address / MEMORY_PAGE_SIZE)[address % MEMORY_PAGE_SIZE];
+    }
+    const uint8_t* page(size_t n) const {
+        return n < LOW_MEMORY_PAGES ? low_.pages[n] : high_->pages[n - LOW_MEMORY_PAGES];
+    }
+    void write(uint16_t address, uint8_t value);
+    void write(uint16_t address, const uint8_t* bytes, size_t size);
+    void read(uint16_t address, uint8_t* out, size_t size) const;
+    bool matches(uint16_t address, const uint8_t* bytes, size_t size) const;
+
+    // back to all zero but the font, in pages every machine shares
+    void reset();
+    // `size` bytes at PROGRAM_START, in pages shared with every machine
+    // that has loaded the same bytes
+    void load_program(const uint8_t* bytes, size_t size);
+
+    // pages this machine has a copy of its own of
+    size_t private_pages() const;
+    // same page, not just same bytes
+    bool shares_page(const PagedMemory& other, size_t n) const { return page(n) == other.page(n); }
+    // for the recompiler: page n's bytes at [n], for the first 4 KB only
+    const uint8_t* const* page_table() const { return low_.pages.data(); }
+
+private:
+    HighPages& own_high();
+
+    PageTable<LOW_MEMORY_PAGES> low_;
+    std::shared_ptr<HighPages> high_;
+};
+
+// Busy-wait loops run() can recognise and skip (see skip_idle()).
+enum IdleState : uint8_t {
+    IDLE_NONE,
+    IDLE_SELF_JUMP,    // 1NNN to itself or 00FD: nothing but a reset gets out
+    IDLE_KEY_WAIT,     // FX0A with no key down
+    IDLE_TIMER_POLL    // FX07 / 3XNN / 1NNN back, DT not there yet
+};
+
+// One complete CHIP-8 machine. Everything the opcodes touch lives in here,
+// so any number of these can run side by side in one process.
+// Registers come first so the hot state shares a cache line.
+struct Chip8 {
+    uint16_t pc = PROGRAM_START;
+    uint16_t i_reg = 0; // index register
+    uint16_t sp = 0; // stack pointer
+    uint8_t delay_timer = 0;
+    uint8_t sound_timer = 0;
+    uint8_t pitch = DEFAULT_PITCH; // FX3A
+    uint8_t planes = 1; // FN01: bit n set = 00E0, DXYN and the scrolls act on plane n
+    std::array<uint8_t, NUM_REGISTERS> v_regs{};
+    std::array<uint16_t, STACK_SIZE> stack{};
+    std::array<bool, NUM_KEYS> keypad{};
+    PagedMemory memory;
+    Framebuffer screen{};
+    // what the beeper plays while sound_timer runs, loaded by F002
+    std::array<uint8_t, AUDIO_PATTERN_SIZE> audio_pattern = DEFAULT_AUDIO_PATTERN;
+    std::array<uint8_t, NUM_RPL_FLAGS> rpl_flags{};
+    uint64_t cycles = 0; // instructions executed since reset
+    // CXNN's generator; per machine and seedable, so runs can be repeated
+    uint64_t rng_seed = DEFAULT_RNG_SEED;
+    uint64_t rng_state = 0;
+
+    // one pre-decoded op per address pc can reach, filled lazily by run()
+    std::vector<DecodedOp> decode_cache;
+    // native translations, only while the recompiler is switched on
+    std::unique_ptr<Jit> jit;
+    // ahead-of-time compiled blocks for the loaded ROM; takes over from the
+    // recompiler while set
+    std::unique_ptr<Aot> aot;
+    // not owned; null = tracing off
+    Tracer* tracer = nullptr;
+    // not owned; null = not recording input
+    Recorder* recorder = nullptr;
+    // not owned; null = no profiling counters
+    Profiler* profiler = nullptr;
+    // not owned; null = no breakpoints, watchpoints or stepping
+    Debugger* debugger = nullptr;
+    // fast-forward through busy-wait loops instead of executing them
+    bool idle_skipping = true;
+    // decode common opcode sequences into superinstructions (see fuse_ops());
+    // flush the decode cache after changing it
+    bool fusing = true;
+    // which interpreter's behaviour the ambiguous opcodes follow; flush the
+    // decode cache after changing it
+    QuirkProfile quirks = QUIRKS_MODERN;
+    // set by run(): the loop the machine was parked in when it returned
+    IdleState idle = IDLE_NONE;
+
+    size_t code_size() const { return code_size_for(QUIRK_PROFILES[quirks]); }
+
+    void initialize_system();
+    bool load_chip8_file(const std::string& filepath);
+    uint16_t grab_opcode();
+    void run_opcode(uint16_t opcode);
+    void update_timers();
+    // takes effect now and again on every initialize_system()
+    void seed_random(uint64_t seed);
+    uint8_t next_random();
+
+    // stores that may hit code (FX33/FX55) go through here
+    void write_memory(uint16_t address, uint8_t value);
+    // call after poking memory directly
+    void invalidate_decode_cache();
+    // DXYN's work: XOR `height` rows from I in at (x, y) into each selected
+    // plane in turn with each plane's rows following the last's; VF =
+    // collision. Height 0 draws what the quirk profile says (16x16, 8x16
+    // or nothing), and the sprite wraps or clips at the edges as it says
+    void draw_sprite(uint8_t x, uint8_t y, uint8_t height);
+    // 00E0 and the SUPER-CHIP/XO-CHIP scrolls, on the selected planes, in
+    // pixels of the current resolution
+    void clear_screen();
+    void scroll_down(uint8_t rows);
+    void scroll_up(uint8_t rows);
+    void scroll_right();
+    void scroll_left();
+    // 00FE/00FF; clears the screen
+    void set_hires(bool on);
+
+    // fetch + execute one instruction
+    void step();
+    // fetch + execute `count` instructions, through the recompiler if it's
+    // on; returns how many ran, fewer only when the debugger stopped it
+    int run(int count);
+    // If pc sits in a busy-wait loop that can't end before the next timer
+    // tick or key change, account for the rest of `count` without running
+    // it and return true. Leaves the machine exactly as executing would.
+    bool skip_idle(int& count);
+    // same, always through the interpreter
+    void interpret(int count);
+    void interpret_traced(int count);
+    void interpret_profiled(int count);
+    int interpret_debugged(int count);
+    // switch the recompiler on/off; false if this host can't run it
+    bool set_jit(bool enabled);
+    // run through a linked-in compiled ROM (find_aot_program()); null = off
+    void set_aot(const AotProgram* program);
+};
+
+extern const uint8_t fontset[FONTSET_SIZE];
+extern const uint8_t big_fontset[BIG_FONTSET_SIZE];
+
+// Function declarations
+std::string millisecs();
+// .ch8/.o8 file names in a directory, sorted
+std::vector<std::string> list_rom_files(const std::string& directory);
+
+#endif // CHIP8_H
@@ -0,0 +1,145 @@
+#include "chip8.h"
+#include "backend.h"
+#include "replay.h"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+
+const uint8_t fontset[FONTSET_SIZE] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+const uint8_t big_fontset[BIG_FONTSET_SIZE] = {
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+    0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+void Chip8::initialize_system() {
+    pc = PROGRAM_START;
+    i_reg = 0;
+    sp = 0;
+    delay_timer = 0;
+    sound_timer = 0;
+    pitch = DEFAULT_PITCH;
+    planes = 1;
+    audio_pattern = DEFAULT_AUDIO_PATTERN;
+    cycles = 0;
+    
+    screen = Framebuffer{};
+    rpl_flags.fill(0);
+    std::memset(&stack, 0, sizeof(stack));
+    std::memset(&v_regs, 0, sizeof(v_regs));
+    std::memset(&keypad, 0, sizeof(keypad));
+    memory.reset();
+    invalidate_decode_cache();
+    seed_random(rng_seed);
+}
+
+// xorshift64*, seeded through splitmix64 so that any seed, 0 included,
+// gives a well-mixed non-zero state
+void Chip8::seed_random(uint64_t seed) {
+    rng_seed = seed;
+    uint64_t z = seed + 0x9E3779B97F4A7C15;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    z ^= z >> 31;
+    rng_state = z ? z : 1;
+}
+
+uint8_t Chip8::next_random() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return static_cast<uint8_t>((rng_state * 0x2545F4914F6CDD1D) >> 56);
+}
+
+uint16_t Chip8::grab_opcode() {
+    const uint16_t mask = code_size() - 1;
+    pc &= mask;
+    uint16_t opcode = (memory[pc] << 8) | memory[(pc + 1) & mask];
+    pc += 2;
+    return opcode;
+}
+
+void Chip8::step() {
+    run(1);
+}
+
+// FNV-1a, a word at a time, over the words that can be lit in this mode;
+// the second plane only counts once something is in it, so a plain
+// CHIP-8 screen hashes as it did when it was 32 words
+uint64_t hash_framebuffer(const Framebuffer& fb) {
+    const size_t words = fb.hires ? Framebuffer::ROW_WORDS : 1;
+    const auto lit = [&](const Framebuffer::Plane& plane) {
+        for (size_t y = 0; y < fb.height(); ++y) {
+            for (size_t w = 0; w < words; ++w) {
+                if (plane[y][w]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (p > 0 && !lit(fb.planes[p])) {
+            continue;
+        }
+        for (size_t y = 0; y < fb.height(); ++y) {
+            for (size_t w = 0; w < words; ++w) {
+                hash = (hash ^ fb.planes[p][y][w]) * 0x100000001b3ull;
+            }
+        }
+    }
+    return hash;
+}
+
+// timing stuff
+std::string millisecs() {
+    auto now = std::chrono::system_clock::now();
+    auto duration = now.time_since_epoch();
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    return std::to_string(millis);
+}
+
+void Chip8::update_timers() {
+    if (recorder) {
+        recorder->timer_tick(*this);
+    }
+    if (delay_timer > 0) {
+        --delay_timer;
+    }
+    
+    if (sound_timer > 0) {
+        --sound_timer;
+    }
+}
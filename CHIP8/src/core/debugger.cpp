@@ -0,0 +1,201 @@
+#include "debugger.h"
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+MemoryAccess memory_access(const Chip8& chip8, const DecodedOp& op) {
+    const uint16_t i = chip8.i_reg & (MEM_SIZE - 1);
+    switch (first_op(op.kind)) {
+        case OP_LD_B_VX: return {i, 3, WATCH_WRITE};
+        case OP_LD_MEM_VX: return {i, static_cast<uint16_t>(op.x + 1), WATCH_WRITE};
+        case OP_LD_VX_MEM: return {i, static_cast<uint16_t>(op.x + 1), WATCH_READ};
+        case OP_SAVE_RANGE: return {i, static_cast<uint16_t>(std::abs(op.x - op.y) + 1), WATCH_WRITE};
+        case OP_LOAD_RANGE: return {i, static_cast<uint16_t>(std::abs(op.x - op.y) + 1), WATCH_READ};
+        case OP_AUDIO: return {i, AUDIO_PATTERN_SIZE, WATCH_READ};
+        case OP_DRW: {
+            // N rows a plane, or for N = 0 whatever the profile draws
+            static constexpr int ZERO_HEIGHT_BYTES[] = {32, 16, 0}; // by ZeroHeightSprite
+            const int bytes = op.n ? op.n : ZERO_HEIGHT_BYTES[QUIRK_PROFILES[chip8.quirks].zero_height];
+            return {i, static_cast<uint16_t>(bytes * std::popcount(static_cast<unsigned>(chip8.planes & 3))), WATCH_READ};
+        }
+        default: return {};
+    }
+}
+
+void Debugger::pause() {
+    mode_ = MODE_RUN;
+    stop(DEBUG_PAUSED);
+}
+
+void Debugger::resume() {
+    mode_ = MODE_RUN;
+    stop_ = DEBUG_RUNNING;
+    skip_breakpoint_ = true;
+}
+
+void Debugger::step() {
+    resume();
+    mode_ = MODE_STEP;
+}
+
+// After a 2NNN sp is one deeper until its 00EE; anything else leaves it
+// where it was (or lower) and so stops after one instruction.
+void Debugger::step_over(const Chip8& chip8) {
+    resume();
+    mode_ = MODE_UNTIL_DEPTH;
+    depth_ = chip8.sp;
+}
+
+// outside any subroutine this is just a step
+void Debugger::step_out(const Chip8& chip8) {
+    resume();
+    mode_ = MODE_UNTIL_DEPTH;
+    depth_ = chip8.sp > 0 ? chip8.sp - 1 : 0;
+}
+
+void Debugger::stop(DebugStop reason) {
+    stop_ = reason;
+    watch_pending_ = false;
+}
+
+bool Debugger::before(const Chip8& chip8, const DecodedOp& op) {
+    if (stop_ != DEBUG_RUNNING) {
+        return false;
+    }
+    const uint16_t pc = chip8.pc & (MEM_SIZE - 1);
+    if (breakpoints_.test(pc) && !skip_breakpoint_) {
+        mode_ = MODE_RUN;
+        stop(DEBUG_BREAKPOINT);
+        return false;
+    }
+    skip_breakpoint_ = false;
+
+    if (!watchpoints_.empty()) {
+        const MemoryAccess access = memory_access(chip8, op);
+        for (const Watchpoint& watch : watchpoints_) {
+            if ((access.access & watch.access) && access.size > 0
+                && access.address <= watch.last && access.address + access.size - 1 >= watch.first) {
+                hit_ = access;
+                watch_pending_ = true;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void Debugger::after(const Chip8& chip8) {
+    if (watch_pending_) {
+        mode_ = MODE_RUN;
+        stop(DEBUG_WATCHPOINT);
+    } else if (mode_ == MODE_STEP || (mode_ == MODE_UNTIL_DEPTH && chip8.sp <= depth_)) {
+        mode_ = MODE_RUN;
+        stop(DEBUG_STEPPED);
+    }
+}
+
+void capture_debug_view(const Chip8& chip8, const Debugger& debugger, DebugView& view) {
+    view.pc = chip8.pc;
+    view.i_reg = chip8.i_reg;
+    view.sp = chip8.sp;
+    view.delay_timer = chip8.delay_timer;
+    view.sound_timer = chip8.sound_timer;
+    view.v_regs = chip8.v_regs;
+    view.stack = chip8.stack;
+    view.cycles = chip8.cycles;
+    view.stop = debugger.stop_reason();
+    view.hit = debugger.watch_hit();
+    uint16_t address = (chip8.pc - 2 * DebugView::LINES_BEFORE_PC) & (MEM_SIZE - 1);
+    for (DebugView::Line& line : view.listing) {
+        line.address = address;
+        line.opcode = (chip8.memory[address] << 8) | chip8.memory[(address + 1) & (MEM_SIZE - 1)];
+        line.breakpoint = debugger.has_breakpoint(address);
+        address = (address + 2) & (MEM_SIZE - 1);
+    }
+}
+
+std::string format_debug_view(const DebugView& view) {
+    std::string text;
+    char line[64];
+    std::snprintf(line, sizeof(line), "%s at cycle %llu\n", debug_stop_name(view.stop),
+                  static_cast<unsigned long long>(view.cycles));
+    text += line;
+    if (view.stop == DEBUG_WATCHPOINT) {
+        std::snprintf(line, sizeof(line), "%s 0x%03X-0x%03X\n", view.hit.access == WATCH_WRITE ? "wrote" : "read",
+                      view.hit.address, view.hit.address + view.hit.size - 1);
+        text += line;
+    }
+    for (size_t r = 0; r < NUM_REGISTERS; ++r) {
+        std::snprintf(line, sizeof(line), "V%zX %02X%s", r, view.v_regs[r], r % 4 == 3 ? "\n" : "  ");
+        text += line;
+    }
+    std::snprintf(line, sizeof(line), "PC %03X  I %03X  DT %02X  ST %02X\n", view.pc, view.i_reg,
+                  view.delay_timer, view.sound_timer);
+    text += line;
+    // oldest return address first, eight to a line
+    text += "stack";
+    for (size_t s = 0; s < view.sp && s < STACK_SIZE; ++s) {
+        std::snprintf(line, sizeof(line), "%s %03X", s > 0 && s % 8 == 0 ? "\n     " : "", view.stack[s]);
+        text += line;
+    }
+    text += '\n';
+    for (const DebugView::Line& entry : view.listing) {
+        std::snprintf(line, sizeof(line), "%c%c %03X  %04X  %s\n", entry.address == view.pc ? '>' : ' ',
+                      entry.breakpoint ? '*' : ' ', entry.address, entry.opcode, disassemble(entry.opcode).c_str());
+        text += line;
+    }
+    return text;
+}
+
+const char* debug_stop_name(DebugStop stop) {
+    switch (stop) {
+        case DEBUG_RUNNING: return "running";
+        case DEBUG_PAUSED: return "paused";
+        case DEBUG_STEPPED: return "stepped";
+        case DEBUG_BREAKPOINT: return "breakpoint";
+        case DEBUG_WATCHPOINT: return "watchpoint";
+        default: return "?";
+    }
+}
+
+bool parse_debug_address(const std::string& text, uint16_t& address) {
+    char* end = nullptr;
+    const unsigned long value = std::strtoul(text.c_str(), &end, 16);
+    if (text.empty() || *end != '\0' || value >= MEM_SIZE) {
+        std::cerr << "Bad address > " << text << std::endl;
+        return false;
+    }
+    address = static_cast<uint16_t>(value);
+    return true;
+}
+
+bool parse_watchpoint(const std::string& text, Watchpoint& watch) {
+    std::string range = text;
+    watch.access = WATCH_ANY;
+    if (const size_t colon = text.find(':'); colon != std::string::npos) {
+        const std::string access = text.substr(colon + 1);
+        range = text.substr(0, colon);
+        if (access == "r") {
+            watch.access = WATCH_READ;
+        } else if (access == "w") {
+            watch.access = WATCH_WRITE;
+        } else if (access != "rw") {
+            std::cerr << "Bad watchpoint access > " << access << std::endl;
+            return false;
+        }
+    }
+    const size_t dash = range.find('-');
+    if (!parse_debug_address(range.substr(0, dash), watch.first)) {
+        return false;
+    }
+    watch.last = watch.first;
+    if (dash != std::string::npos && !parse_debug_address(range.substr(dash + 1), watch.last)) {
+        return false;
+    }
+    if (watch.last < watch.first) {
+        std::cerr << "Bad watchpoint range > " << range << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+#include <bitset>
+#include <string>
+#include <vector>
+#include "chip8.h"
+
+enum WatchAccess : uint8_t {
+    WATCH_READ = 1 << 0,    // FX65, 5XY3, DXYN's sprite, F002's pattern
+    WATCH_WRITE = 1 << 1,   // FX33, FX55, 5XY2
+    WATCH_ANY = WATCH_READ | WATCH_WRITE
+};
+
+// Memory an instruction will read or write when run from the machine's
+// current state; size 0 = none.
+struct MemoryAccess {
+    uint16_t address = 0;
+    uint16_t size = 0;
+    uint8_t access = 0;
+};
+MemoryAccess memory_access(const Chip8& chip8, const DecodedOp& op);
+
+struct Watchpoint {
+    uint16_t first;
+    uint16_t last;
+    uint8_t access;
+};
+
+// Why the machine isn't running.
+enum DebugStop : uint8_t {
+    DEBUG_RUNNING,
+    DEBUG_PAUSED,       // pause() or attached that way
+    DEBUG_STEPPED,      // a step finished
+    DEBUG_BREAKPOINT,   // about to run the instruction at a breakpoint
+    DEBUG_WATCHPOINT    // the instruction before pc touched a watched range
+};
+
+// Breakpoints, watchpoints and stepping for one machine. Attached through
+// chip8.debugger, which sends run() down a one-at-a-time loop that asks
+// before() and after() around every instruction; with no debugger attached
+// that is the one branch run() takes for it, and nothing else changes.
+// Only the thread running the machine may call into it, like the machine
+// itself.
+class Debugger {
+public:
+    void toggle_breakpoint(uint16_t address) { breakpoints_.flip(address & (MEM_SIZE - 1)); }
+    void set_breakpoint(uint16_t address, bool on = true) { breakpoints_.set(address & (MEM_SIZE - 1), on); }
+    bool has_breakpoint(uint16_t address) const { return breakpoints_.test(address & (MEM_SIZE - 1)); }
+    void add_watchpoint(const Watchpoint& watch) { watchpoints_.push_back(watch); }
+    void clear_watchpoints() { watchpoints_.clear(); }
+    const std::vector<Watchpoint>& watchpoints() const { return watchpoints_; }
+
+    void pause();
+    // run on; a breakpoint at pc doesn't stop it again straight away
+    void resume();
+    // one instruction
+    void step();
+    // one instruction, or a whole 2NNN call until it has returned
+    void step_over(const Chip8& chip8);
+    // until the current subroutine's 00EE has run
+    void step_out(const Chip8& chip8);
+
+    bool paused() const { return stop_ != DEBUG_RUNNING; }
+    DebugStop stop_reason() const { return stop_; }
+    // for DEBUG_WATCHPOINT: what the instruction touched
+    const MemoryAccess& watch_hit() const { return hit_; }
+
+    // the interpreter's side: false = don't run the instruction at pc
+    bool before(const Chip8& chip8, const DecodedOp& op);
+    void after(const Chip8& chip8);
+
+private:
+    enum Mode : uint8_t {
+        MODE_RUN,
+        MODE_STEP,
+        MODE_UNTIL_DEPTH   // until sp is back down to depth_
+    };
+
+    void stop(DebugStop reason);
+
+    std::bitset<MEM_SIZE> breakpoints_;
+    std::vector<Watchpoint> watchpoints_;
+    Mode mode_ = MODE_RUN;
+    DebugStop stop_ = DEBUG_RUNNING;
+    int depth_ = 0;
+    bool skip_breakpoint_ = false;  // the first instruction after a resume
+    bool watch_pending_ = false;    // stop once the current instruction ran
+    MemoryAccess hit_{};
+};
+
+// What a frontend shows of a paused (or running) machine, copied out so it
+// can be drawn on another thread.
+struct DebugView {
+    static constexpr size_t LISTING_LINES = 16;
+    static constexpr size_t LINES_BEFORE_PC = 4;
+    struct Line {
+        uint16_t address;
+        uint16_t opcode;
+        bool breakpoint;
+    };
+
+    uint16_t pc = 0;
+    uint16_t i_reg = 0;
+    uint16_t sp = 0;
+    uint8_t delay_timer = 0;
+    uint8_t sound_timer = 0;
+    std::array<uint8_t, NUM_REGISTERS> v_regs{};
+    std::array<uint16_t, STACK_SIZE> stack{};
+    uint64_t cycles = 0;
+    DebugStop stop = DEBUG_RUNNING;
+    MemoryAccess hit{};
+    // a word at a time from a few instructions before pc
+    std::array<Line, LISTING_LINES> listing{};
+};
+void capture_debug_view(const Chip8& chip8, const Debugger& debugger, DebugView& view);
+// registers, stack and listing as text, pc's line marked with '>' and
+// breakpoints with '*'
+std::string format_debug_view(const DebugView& view);
+const char* debug_stop_name(DebugStop stop);
+
+// hex, "2A0" or "0x2A0"; false on anything else
+bool parse_debug_address(const std::string& text, uint16_t& address);
+// "<first>[-<last>][:r|w|rw]", e.g. "0x300-0x30F:w"; rw by default
+bool parse_watchpoint(const std::string& text, Watchpoint& watch);
+
+#endif // DEBUGGER_H
@@ -0,0 +1,107 @@
+#ifndef DECODE_H
+#define DECODE_H
+#include <cstdint>
+#include <string>
+#include "quirks.h"
+
+// Every instruction the interpreter knows, one handler each.
+enum OpKind : uint8_t {
+    OP_UNDECODED,   // cache slot not filled yet (or invalidated by a write)
+    OP_UNKNOWN,
+    OP_SYS,         // 0NNN, ignored
+    OP_CLS,         // 00E0
+    OP_RET,         // 00EE
+    OP_JP,          // 1NNN
+    OP_CALL,        // 2NNN
+    OP_SE_VX_NN,    // 3XNN
+    OP_SNE_VX_NN,   // 4XNN
+    OP_SE_VX_VY,    // 5XY0
+    OP_LD_VX_NN,    // 6XNN
+    OP_ADD_VX_NN,   // 7XNN
+    OP_LD_VX_VY,    // 8XY0
+    OP_OR_VX_VY,        // 8XY1
+    OP_AND_VX_VY,        // 8XY2
+    OP_XOR_VX_VY,        // 8XY3
+    OP_ADD_VX_VY,   // 8XY4
+    OP_SUB,         // 8XY5
+    OP_SHR,         // 8XY6
+    OP_SUBN,        // 8XY7
+    OP_SHL,         // 8XYE
+    OP_SNE_VX_VY,   // 9XY0
+    OP_LD_I,        // ANNN
+    OP_JP_V0,       // BNNN
+    OP_RND,         // CXNN
+    OP_DRW,         // DXYN
+    OP_SKP,         // EX9E
+    OP_SKNP,        // EXA1
+    OP_LD_VX_DT,    // FX07
+    OP_LD_VX_K,     // FX0A
+    OP_LD_DT_VX,    // FX15
+    OP_LD_ST_VX,    // FX18
+    OP_ADD_I_VX,    // FX1E
+    OP_LD_F_VX,     // FX29
+    OP_LD_B_VX,     // FX33
+    OP_LD_MEM_VX,   // FX55
+    OP_LD_VX_MEM,   // FX65
+    OP_AUDIO,       // F002, XO-CHIP
+    OP_LD_PITCH_VX, // FX3A, XO-CHIP
+    OP_SCD,         // 00CN, SUPER-CHIP
+    OP_SCU,         // 00DN, XO-CHIP
+    OP_SCR,         // 00FB, SUPER-CHIP
+    OP_SCL,         // 00FC, SUPER-CHIP
+    OP_EXIT,        // 00FD, SUPER-CHIP
+    OP_LOW,         // 00FE, SUPER-CHIP
+    OP_HIGH,        // 00FF, SUPER-CHIP
+    OP_SAVE_RANGE,  // 5XY2, XO-CHIP
+    OP_LOAD_RANGE,  // 5XY3, XO-CHIP
+    OP_LD_I_LONG,   // F000 NNNN, XO-CHIP; the only 4-byte instruction
+    OP_PLANE,       // FN01, XO-CHIP, the N in x
+    OP_LD_HF_VX,    // FX30, SUPER-CHIP
+    OP_SAVE_FLAGS,  // FX75, SUPER-CHIP
+    OP_LOAD_FLAGS,  // FX85, SUPER-CHIP
+    // superinstructions, see fuse_ops()
+    OP_LD_I_DRW,    // ANNN DXYN
+    OP_LD_VX_VY_NN, // 6XNN 6YNN, the second NN in n
+    OP_WAIT_DT,     // FX07 3YNN 1NNN, the NN in n
+    OP_ADD_SE,      // 7XNN 3YNN, the second NN in n
+    OP_COUNT,
+    OP_FIRST_FUSED = OP_LD_I_DRW
+};
+
+// The instruction a superinstruction starts with. A fused op keeps all of
+// that instruction's fields, so it can always be run as just that one.
+constexpr OpKind first_op(OpKind kind) {
+    switch (kind) {
+        case OP_LD_I_DRW: return OP_LD_I;
+        case OP_LD_VX_VY_NN: return OP_LD_VX_NN;
+        case OP_WAIT_DT: return OP_LD_VX_DT;
+        case OP_ADD_SE: return OP_ADD_VX_NN;
+        default: return kind;
+    }
+}
+
+// An instruction with its fields already pulled out of the opcode.
+struct DecodedOp {
+    OpKind kind = OP_UNDECODED;
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t n = 0;
+    uint8_t nn = 0;
+    uint16_t nnn = 0;
+};
+static_assert(sizeof(DecodedOp) == 8);
+
+DecodedOp decode_opcode(uint16_t opcode);
+// Peephole pass over one decode cache slot: if `first` and the opcodes
+// after it form one of the common idioms, the superinstruction doing all of
+// them in one dispatch, otherwise `first` as is.
+DecodedOp fuse_ops(const DecodedOp& first, uint16_t second, uint16_t third);
+// the pair starts an idiom fuse_ops() knows
+bool fuses(OpKind first, OpKind second);
+// bit n set = the op reads or writes Vn under these quirks
+uint16_t registers_touched(const DecodedOp& op, const Quirks& quirks = QUIRK_PROFILES[QUIRKS_MODERN]);
+std::string disassemble(uint16_t opcode);
+// the opcode pattern a kind stands for, e.g. "8XY4"
+const char* op_kind_pattern(OpKind kind);
+
+#endif // DECODE_H
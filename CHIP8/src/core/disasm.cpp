@@ -0,0 +1,78 @@
+#include "decode.h"
+#include <cstdio>
+
+// Cowgod-style mnemonics, e.g. "LD V3, 0x1F" or "DRW V0, V1, 5"
+std::string disassemble(uint16_t opcode) {
+    const DecodedOp op = decode_opcode(opcode);
+    char text[32];
+    switch (op.kind) {
+        case OP_SYS: std::snprintf(text, sizeof(text), "SYS 0x%03X", op.nnn); break;
+        case OP_CLS: std::snprintf(text, sizeof(text), "CLS"); break;
+        case OP_RET: std::snprintf(text, sizeof(text), "RET"); break;
+        case OP_JP: std::snprintf(text, sizeof(text), "JP 0x%03X", op.nnn); break;
+        case OP_CALL: std::snprintf(text, sizeof(text), "CALL 0x%03X", op.nnn); break;
+        case OP_SE_VX_NN: std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", op.x, op.nn); break;
+        case OP_SNE_VX_NN: std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", op.x, op.nn); break;
+        case OP_SE_VX_VY: std::snprintf(text, sizeof(text), "SE V%X, V%X", op.x, op.y); break;
+        case OP_LD_VX_NN: std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", op.x, op.nn); break;
+        case OP_ADD_VX_NN: std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", op.x, op.nn); break;
+        case OP_LD_VX_VY: std::snprintf(text, sizeof(text), "LD V%X, V%X", op.x, op.y); break;
+        case OP_OR_VX_VY: std::snprintf(text, sizeof(text), "OR V%X, V%X", op.x, op.y); break;
+        case OP_AND_VX_VY: std::snprintf(text, sizeof(text), "AND V%X, V%X", op.x, op.y); break;
+        case OP_XOR_VX_VY: std::snprintf(text, sizeof(text), "XOR V%X, V%X", op.x, op.y); break;
+        case OP_ADD_VX_VY: std::snprintf(text, sizeof(text), "ADD V%X, V%X", op.x, op.y); break;
+        case OP_SUB: std::snprintf(text, sizeof(text), "SUB V%X, V%X", op.x, op.y); break;
+        case OP_SHR: std::snprintf(text, sizeof(text), "SHR V%X, V%X", op.x, op.y); break;
+        case OP_SUBN: std::snprintf(text, sizeof(text), "SUBN V%X, V%X", op.x, op.y); break;
+        case OP_SHL: std::snprintf(text, sizeof(text), "SHL V%X, V%X", op.x, op.y); break;
+        case OP_SNE_VX_VY: std::snprintf(text, sizeof(text), "SNE V%X, V%X", op.x, op.y); break;
+        case OP_LD_I: std::snprintf(text, sizeof(text), "LD I, 0x%03X", op.nnn); break;
+        case OP_JP_V0: std::snprintf(text, sizeof(text), "JP V0, 0x%03X", op.nnn); break;
+        case OP_RND: std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", op.x, op.nn); break;
+        case OP_DRW: std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", op.x, op.y, op.n); break;
+        case OP_SKP: std::snprintf(text, sizeof(text), "SKP V%X", op.x); break;
+        case OP_SKNP: std::snprintf(text, sizeof(text), "SKNP V%X", op.x); break;
+        case OP_LD_VX_DT: std::snprintf(text, sizeof(text), "LD V%X, DT", op.x); break;
+        case OP_LD_VX_K: std::snprintf(text, sizeof(text), "LD V%X, K", op.x); break;
+        case OP_LD_DT_VX: std::snprintf(text, sizeof(text), "LD DT, V%X", op.x); break;
+        case OP_LD_ST_VX: std::snprintf(text, sizeof(text), "LD ST, V%X", op.x); break;
+        case OP_ADD_I_VX: std::snprintf(text, sizeof(text), "ADD I, V%X", op.x); break;
+        case OP_LD_F_VX: std::snprintf(text, sizeof(text), "LD F, V%X", op.x); break;
+        case OP_LD_B_VX: std::snprintf(text, sizeof(text), "LD B, V%X", op.x); break;
+        case OP_LD_MEM_VX: std::snprintf(text, sizeof(text), "LD [I], V%X", op.x); break;
+        case OP_LD_VX_MEM: std::snprintf(text, sizeof(text), "LD V%X, [I]", op.x); break;
+        case OP_AUDIO: std::snprintf(text, sizeof(text), "AUDIO"); break;
+        case OP_LD_PITCH_VX: std::snprintf(text, sizeof(text), "LD PITCH, V%X", op.x); break;
+        case OP_SCD: std::snprintf(text, sizeof(text), "SCD %u", op.n); break;
+        case OP_SCU: std::snprintf(text, sizeof(text), "SCU %u", op.n); break;
+        case OP_SCR: std::snprintf(text, sizeof(text), "SCR"); break;
+        case OP_SCL: std::snprintf(text, sizeof(text), "SCL"); break;
+        case OP_EXIT: std::snprintf(text, sizeof(text), "EXIT"); break;
+        case OP_LOW: std::snprintf(text, sizeof(text), "LOW"); break;
+        case OP_HIGH: std::snprintf(text, sizeof(text), "HIGH"); break;
+        case OP_SAVE_RANGE: std::snprintf(text, sizeof(text), "SAVE V%X-V%X", op.x, op.y); break;
+        case OP_LOAD_RANGE: std::snprintf(text, sizeof(text), "LOAD V%X-V%X", op.x, op.y); break;
+        case OP_LD_I_LONG: std::snprintf(text, sizeof(text), "LD I, LONG"); break;
+        case OP_PLANE: std::snprintf(text, sizeof(text), "PLANE %u", op.x); break;
+        case OP_LD_HF_VX: std::snprintf(text, sizeof(text), "LD HF, V%X", op.x); break;
+        case OP_SAVE_FLAGS: std::snprintf(text, sizeof(text), "LD R, V%X", op.x); break;
+        case OP_LOAD_FLAGS: std::snprintf(text, sizeof(text), "LD V%X, R", op.x); break;
+        default: std::snprintf(text, sizeof(text), "DW 0x%04X", opcode); break;
+    }
+    return text;
+}
+
+const char* op_kind_pattern(OpKind kind) {
+    static const char* const patterns[OP_COUNT] = {
+        "----", "????", "0NNN", "00E0", "00EE", "1NNN", "2NNN",
+        "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+        "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+        "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29",
+        "FX33", "FX55", "FX65", "F002", "FX3A",
+        "00CN", "00DN", "00FB", "00FC", "00FD", "00FE", "00FF",
+        "5XY2", "5XY3", "F000", "FN01", "FX30", "FX75", "FX85",
+        "ANNN+DXYN", "6XNN+6YNN", "FX07+3YNN+1NNN", "7XNN+3YNN",
+    };
+    return kind < OP_COUNT ? patterns[kind] : "????";
+}
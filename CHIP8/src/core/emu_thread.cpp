@@ -0,0 +1,188 @@
+#include "emu_thread.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyStats::record(int64_t ns) {
+    ++samples;
+    total_ns += ns;
+    if (ns > max_ns) {
+        max_ns = ns;
+    }
+}
+
+EmulationThread::EmulationThread(Chip8& chip8, uint32_t ips)
+    : chip8_(chip8), ips_(ips) {}
+
+EmulationThread::~EmulationThread() {
+    stop();
+}
+
+void EmulationThread::set_rewind(size_t budget_bytes, uint32_t interval_frames) {
+    rewind_ = RewindBuffer(budget_bytes, interval_frames);
+}
+
+void EmulationThread::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&EmulationThread::loop, this);
+}
+
+void EmulationThread::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void EmulationThread::loop() {
+    Bridge bridge(*this);
+    Scheduler scheduler(ips_.load(std::memory_order_relaxed));
+    constexpr int64_t SUMMARY_INTERVAL_NS = 500000000;
+    int64_t last_summary = 0;
+    while (!bridge.should_quit()) {
+        switch (command_.exchange(COMMAND_NONE, std::memory_order_relaxed)) {
+        case COMMAND_SAVE:
+            if (save_state(chip8_, state_path_)) {
+                std::cerr << "State saved to " << state_path_ << std::endl;
+            }
+            break;
+        case COMMAND_LOAD:
+            if (load_state(chip8_, state_path_)) {
+                std::cerr << "State loaded from " << state_path_ << std::endl;
+                rewind_.clear();
+                scheduler.restart();
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (Debugger* debugger = chip8_.debugger) {
+            run_debug_command(*debugger);
+            if (debugger->paused()) {
+                capture_debug_view(chip8_, *debugger, debug_views_.back());
+                debug_views_.publish();
+                bridge.present(chip8_);
+                if (audio_) {
+                    audio_->silence();
+                }
+                scheduler.restart();
+                std::this_thread::sleep_for(std::chrono::nanoseconds(1000000000 / Scheduler::TIMER_HZ));
+                continue;
+            }
+        }
+
+        if (rewinding_.load(std::memory_order_relaxed)) {
+            if (rewind_.rewind(chip8_)) {
+                bridge.present(chip8_);
+            }
+            if (audio_) {
+                audio_->silence();
+            }
+            scheduler.restart();
+            std::this_thread::sleep_for(std::chrono::nanoseconds(1000000000 / Scheduler::TIMER_HZ));
+            continue;
+        }
+
+        scheduler.set_ips(ips_.load(std::memory_order_relaxed));
+        scheduler.set_turbo(turbo_.load(std::memory_order_relaxed));
+        const int64_t slice_start = steady_now_ns();
+        const auto next = scheduler.run_slice(chip8_, bridge, Scheduler::clock::now());
+        if (Profiler* profiler = chip8_.profiler) {
+            const int64_t now = steady_now_ns();
+            profiler->emulate.record(now - slice_start);
+            if (now - last_summary >= SUMMARY_INTERVAL_NS) {
+                profiler->summarize(profiles_.back(), chip8_.cycles, now);
+                profiles_.publish();
+                last_summary = now;
+            }
+        }
+        if (chip8_.debugger) {
+            capture_debug_view(chip8_, *chip8_.debugger, debug_views_.back());
+            debug_views_.publish();
+        }
+        rewind_.on_frame(chip8_);
+        if (!scheduler.turbo()) {
+            std::this_thread::sleep_until(next);
+        } else if (chip8_.idle == IDLE_KEY_WAIT || chip8_.idle == IDLE_SELF_JUMP) {
+            // fast-forwarding a machine that only waits for a key would just
+            // spin; let it run at the normal rate until something changes
+            std::this_thread::sleep_for(std::chrono::nanoseconds(1000000000 / Scheduler::TIMER_HZ));
+        }
+    }
+    if (audio_) {
+        audio_->silence();
+    }
+}
+
+// A step runs its instruction right here, without a timer tick; a step
+// over a 2NNN that is still inside the call afterwards goes on in the
+// following slices.
+void EmulationThread::run_debug_command(Debugger& debugger) {
+    const uint32_t request = debug_command_.exchange(0, std::memory_order_relaxed);
+    switch (request >> 16) {
+    case DEBUG_COMMAND_PAUSE:
+        debugger.pause();
+        break;
+    case DEBUG_COMMAND_CONTINUE:
+        debugger.resume();
+        break;
+    case DEBUG_COMMAND_STEP:
+        debugger.step();
+        chip8_.run(1);
+        break;
+    case DEBUG_COMMAND_STEP_OVER:
+        debugger.step_over(chip8_);
+        chip8_.run(1);
+        break;
+    case DEBUG_COMMAND_STEP_OUT:
+        debugger.step_out(chip8_);
+        break;
+    case DEBUG_COMMAND_TOGGLE_BREAKPOINT:
+        debugger.toggle_breakpoint(request & 0xFFFF);
+        break;
+    default:
+        break;
+    }
+}
+
+void EmulationThread::Bridge::poll_input(Chip8& chip8) {
+    // the scheduler polls right before executing, so this also marks the start
+    // of the batch any DXYN in this frame belongs to
+    frame_start_ = steady_now_ns();
+    const uint16_t mask = owner_.keys_.load(std::memory_order_relaxed);
+    for (size_t key = 0; key < NUM_KEYS; ++key) {
+        chip8.keypad[key] = (mask >> key) & 1;
+    }
+}
+
+// Only changed screens are published, so a renderer that misses a frame
+// still gets the latency stamp of the draw it ends up showing.
+void EmulationThread::Bridge::present(const Chip8& chip8) {
+    if (chip8.screen == published_) {
+        return;
+    }
+    EmuFrame& frame = owner_.frames_.back();
+    frame.screen = chip8.screen;
+    frame.cycle = chip8.cycles;
+    frame.drawn_at = frame_start_;
+    owner_.frames_.publish();
+    published_ = chip8.screen;
+}
+
+void EmulationThread::Bridge::set_sound(const Chip8& chip8) {
+    if (owner_.audio_) {
+        owner_.audio_->update(chip8);
+    }
+}
+
+bool EmulationThread::Bridge::should_quit() {
+    return !owner_.running_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,139 @@
+#ifndef EMU_THREAD_H
+#define EMU_THREAD_H
+#include "audio.h"
+#include "debugger.h"
+#include "profiler.h"
+#include "rewind.h"
+#include "scheduler.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <thread>
+
+// A finished screen handed from the emulation thread to the renderer.
+struct EmuFrame {
+    Framebuffer screen{};
+    uint64_t cycle = 0;
+    // steady_clock nanoseconds at the start of the emulated frame whose
+    // DXYN/00E0 produced this screen (0 if nothing has been drawn yet)
+    int64_t drawn_at = 0;
+};
+
+// DXYN-to-screen latency samples, kept on the render thread.
+struct LatencyStats {
+    uint64_t samples = 0;
+    int64_t total_ns = 0;
+    int64_t max_ns = 0;
+
+    void record(int64_t ns);
+    double mean_ms() const { return samples ? total_ns / 1e6 / samples : 0.0; }
+    double max_ms() const { return max_ns / 1e6; }
+};
+
+int64_t steady_now_ns();
+
+// Runs a machine on its own thread, paced by a Scheduler. The frontend
+// never touches the Chip8 while this is running: keys go in through an
+// atomic bitmask, screens come out through a triple buffer, and the sound
+// state goes straight to the AudioSynth's. A slow renderer (vsync, window
+// drags) therefore can't slow down emulation, and emulation can't block a
+// frame.
+class EmulationThread {
+public:
+    EmulationThread(Chip8& chip8, uint32_t ips = Scheduler::DEFAULT_IPS);
+    ~EmulationThread();
+    EmulationThread(const EmulationThread&) = delete;
+    EmulationThread& operator=(const EmulationThread&) = delete;
+
+    // before start(): where F5/F9-style save/load requests go, and the
+    // rewind history size
+    void set_state_path(const std::string& filepath) { state_path_ = filepath; }
+    void set_rewind(size_t budget_bytes, uint32_t interval_frames);
+    // not owned; null = no sound
+    void set_audio(AudioSynth* audio) { audio_ = audio; }
+
+    void start();
+    void stop();
+
+    // render thread side
+    void set_keys(uint16_t mask) { keys_.store(mask, std::memory_order_relaxed); }
+    void set_ips(uint32_t ips) { ips_.store(ips, std::memory_order_relaxed); }
+    uint32_t ips() const { return ips_.load(std::memory_order_relaxed); }
+    void set_turbo(bool on) { turbo_.store(on, std::memory_order_relaxed); }
+    // while on, the machine steps backwards one snapshot per tick
+    void set_rewinding(bool on) { rewinding_.store(on, std::memory_order_relaxed); }
+    // handled on the emulation thread between slices
+    void request_save() { command_.store(COMMAND_SAVE, std::memory_order_relaxed); }
+    void request_load() { command_.store(COMMAND_LOAD, std::memory_order_relaxed); }
+    // true if a newer screen than last time is now in frame()
+    bool poll_frame() { return frames_.update(); }
+    const EmuFrame& frame() const { return frames_.front(); }
+    // with chip8.profiler set: the latest summary, refreshed twice a second
+    const ProfileSummary& profile_summary() {
+        profiles_.update();
+        return profiles_.front();
+    }
+
+    // With chip8.debugger set: the debugger is driven from the emulation
+    // thread between slices, and a paused machine stays put, timers and all.
+    enum DebugCommand : uint8_t {
+        DEBUG_COMMAND_NONE,
+        DEBUG_COMMAND_PAUSE,
+        DEBUG_COMMAND_CONTINUE,
+        DEBUG_COMMAND_STEP,
+        DEBUG_COMMAND_STEP_OVER,
+        DEBUG_COMMAND_STEP_OUT,
+        DEBUG_COMMAND_TOGGLE_BREAKPOINT   // at `address`
+    };
+    void request_debug(DebugCommand command, uint16_t address = 0) {
+        debug_command_.store(static_cast<uint32_t>(command) << 16 | address, std::memory_order_relaxed);
+    }
+    // registers, stack and listing, refreshed after every slice
+    const DebugView& debug_view() {
+        debug_views_.update();
+        return debug_views_.front();
+    }
+
+private:
+    // Adapts the cross-thread channels to the Backend interface so the
+    // emulation thread drives the machine through the usual Scheduler.
+    class Bridge : public Backend {
+    public:
+        explicit Bridge(EmulationThread& owner) : owner_(owner) {}
+        void poll_input(Chip8& chip8) override;
+        void present(const Chip8& chip8) override;
+        void set_sound(const Chip8& chip8) override;
+        bool should_quit() override;
+
+    private:
+        EmulationThread& owner_;
+        int64_t frame_start_ = 0;
+        Framebuffer published_{};
+    };
+
+    enum Command : uint8_t {
+        COMMAND_NONE,
+        COMMAND_SAVE,
+        COMMAND_LOAD
+    };
+
+    void loop();
+    void run_debug_command(Debugger& debugger);
+
+    Chip8& chip8_;
+    std::string state_path_;
+    RewindBuffer rewind_;
+    AudioSynth* audio_ = nullptr;
+    std::atomic<bool> rewinding_{false};
+    std::atomic<uint8_t> command_{COMMAND_NONE};
+    std::atomic<uint32_t> debug_command_{0};
+    std::atomic<uint32_t> ips_;
+    std::atomic<bool> turbo_{false};
+    std::atomic<uint16_t> keys_{0};
+    std::atomic<bool> running_{false};
+    TripleBuffer<EmuFrame> frames_;
+    TripleBuffer<ProfileSummary> profiles_;
+    TripleBuffer<DebugView> debug_views_;
+    std::thread thread_;
+};
+
+#endif // EMU_THREAD_H
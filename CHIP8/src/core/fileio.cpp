@@ -0,0 +1,33 @@
+#include "chip8.h"
+#include "rom_library.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+bool Chip8::load_chip8_file(const std::string& filepath) {
+    MappedRom rom;
+    if (!rom.open(filepath)) {
+        return false;
+    }
+
+    if (rom.size() > (MEM_SIZE - PROGRAM_START)) {
+        std::cerr << "File too large..." << std::endl;
+        return false;
+    }
+
+    memory.load_program(rom.data(), rom.size());
+
+    invalidate_decode_cache();
+    return true;
+}
+
+std::vector<std::string> list_rom_files(const std::string& directory) {
+    std::vector<std::string> rom_files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".ch8" || entry.path().extension() == ".o8") {
+            rom_files.push_back(entry.path().filename().string());
+        }
+    }
+    std::sort(rom_files.begin(), rom_files.end());
+    return rom_files;
+}
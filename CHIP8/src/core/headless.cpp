@@ -0,0 +1,76 @@
+#include "headless.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// events for the same cycle keep their order in the script
+void sort_script(std::vector<KeyEvent>& script) {
+    std::stable_sort(script.begin(), script.end(),
+                     [](const KeyEvent& a, const KeyEvent& b) { return a.cycle < b.cycle; });
+}
+
+} // namespace
+
+HeadlessBackend::HeadlessBackend(std::vector<KeyEvent> script) : script_(std::move(script)) {
+    sort_script(script_);
+}
+
+bool HeadlessBackend::load_key_script(const std::string& filepath) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open key script > " << filepath << std::endl;
+        return false;
+    }
+
+    std::vector<KeyEvent> events;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        uint64_t cycle;
+        unsigned int key;
+        std::string state;
+        if (!(in >> cycle)) {
+            continue; // blank or comment
+        }
+        if (!(in >> std::hex >> key >> state) || key >= NUM_KEYS || (state != "down" && state != "up")) {
+            std::cerr << "Bad key script line " << line_no << " > " << line << std::endl;
+            return false;
+        }
+        events.push_back({cycle, static_cast<uint8_t>(key), state == "down"});
+    }
+
+    // only the script changes: capture, the framebuffer and the counters
+    // carry on
+    sort_script(events);
+    script_ = std::move(events);
+    next_event_ = 0;
+    return true;
+}
+
+void HeadlessBackend::poll_input(Chip8& chip8) {
+    while (next_event_ < script_.size() && script_[next_event_].cycle <= chip8.cycles) {
+        keys_[script_[next_event_].key] = script_[next_event_].pressed;
+        ++next_event_;
+    }
+    chip8.keypad = keys_;
+}
+
+void HeadlessBackend::present(const Chip8& chip8) {
+    framebuffer = chip8.screen;
+    ++frames_presented;
+    if (capture) {
+        capture->capture(chip8.screen, chip8.cycles);
+    }
+}
+
+void HeadlessBackend::set_sound(const Chip8& chip8) {
+    if (chip8.sound_timer > 0) {
+        ++beep_frames;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+#include "backend.h"
+#include "capture.h"
+#include <vector>
+
+// A key going down or up once the machine has executed `cycle` instructions.
+struct KeyEvent {
+    uint64_t cycle;
+    uint8_t key;
+    bool pressed;
+};
+
+// No window, no audio device: the framebuffer is kept in memory and keys
+// come from a script. Lets ROMs run at full host speed on display-less boxes.
+class HeadlessBackend : public Backend {
+public:
+    Framebuffer framebuffer{};
+    uint64_t frames_presented = 0;
+    uint64_t beep_frames = 0;
+    // not owned; null = not capturing frames
+    FrameCapture* capture = nullptr;
+
+    HeadlessBackend() = default;
+    explicit HeadlessBackend(std::vector<KeyEvent> script);
+
+    // script file: one "<cycle> <key hex> <down|up>" per line, # comments;
+    // replaces the script only, and leaves it alone if the file is bad
+    bool load_key_script(const std::string& filepath);
+
+    void poll_input(Chip8& chip8) override;
+    void present(const Chip8& chip8) override;
+    void set_sound(const Chip8& chip8) override;
+
+private:
+    std::vector<KeyEvent> script_;
+    size_t next_event_ = 0;
+    std::array<bool, NUM_KEYS> keys_{};
+};
+
+#endif // HEADLESS_H
@@ -0,0 +1,656 @@
+#include "jit.h"
+#include "chip8.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define CHIP8_JIT_X64 1
+#include <sys/mman.h>
+#endif
+
+#ifdef CHIP8_JIT_X64
+namespace {
+
+constexpr size_t CODE_SIZE = 1 << 20;
+constexpr size_t MAX_BLOCK_OPS = 32;
+constexpr uint8_t SELF_MODIFYING = 3;     // rewrites before code stays interpreted
+
+enum Reg : int { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum Cond : uint8_t { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_L = 0xC };
+
+// ALU opcodes in "op r/m32, r32" form and their /digit for the imm32 form
+enum : uint8_t { X_ADD = 0x01, X_OR = 0x09, X_AND = 0x21, X_SUB = 0x29, X_XOR = 0x31, X_CMP = 0x39, X_MOV = 0x89, X_TEST = 0x85 };
+enum : int { I_ADD = 0, I_AND = 4, I_SUB = 5, I_CMP = 7, S_SHL = 4, S_SHR = 5 };
+
+// Block register usage: rdi = Chip8*, esi = instruction budget, eax/ecx/edx
+// scratch. V registers a block touches live in these for its duration.
+constexpr Reg guest_pool[] = { RBX, RBP, R8, R9, R10, R11, R12, R13, R14, R15 };
+constexpr int POOL_SIZE = sizeof(guest_pool) / sizeof(guest_pool[0]);
+
+// Just enough of an x86-64 assembler for the blocks below. Memory operands
+// are [rdi + disp32] or [rdi + index*scale + disp32], apart from the
+// [base + index] FX65 reads guest memory through.
+//
+// Nothing is written at or past `end`; code that would go there sets
+// overflowed() instead, and the caller throws it away.
+class Emitter {
+public:
+    Emitter(uint8_t* base, size_t pos, size_t end) : base_(base), pos_(pos), end_(end) {}
+    size_t pos() const { return pos_; }
+    bool overflowed() const { return overflowed_; }
+
+    void byte(uint8_t b) { put(&b, 1); }
+    void u16(uint16_t v) { put(&v, 2); }
+    void u32(uint32_t v) { put(&v, 4); }
+    void u64(uint64_t v) { put(&v, 8); }
+
+    void rex(bool w, int reg, int index, int rm, bool force = false) {
+        uint8_t r = 0x40 | (w << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((rm >> 3) & 1);
+        if (r != 0x40 || force) {
+            byte(r);
+        }
+    }
+    void direct(int reg, int rm) { byte(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+    void mem(int reg, int32_t disp) { byte(0x80 | (reg & 7) << 3 | RDI); u32(disp); }
+    void mem_idx(int reg, int index, int scale_log2, int32_t disp) {
+        byte(0x84 | (reg & 7) << 3);
+        byte(scale_log2 << 6 | (index & 7) << 3 | RDI);
+        u32(disp);
+    }
+
+    void mov_imm(int r, uint32_t imm) { rex(false, 0, 0, r); byte(0xB8 | (r & 7)); u32(imm); }
+    void mov_imm64(int r, uint64_t imm) { rex(true, 0, 0, r); byte(0xB8 | (r & 7)); u64(imm); }
+    void alu(uint8_t opcode, int dst, int src) { rex(false, src, 0, dst); byte(opcode); direct(src, dst); }
+    void alu_imm(int ext, int r, uint32_t imm) { rex(false, 0, 0, r); byte(0x81); direct(ext, r); u32(imm); }
+    void shift(int ext, int r, uint8_t n) { rex(false, 0, 0, r); byte(0xC1); direct(ext, r); byte(n); }
+    void setcc(Cond cc, int r) { rex(false, 0, 0, r, true); byte(0x0F); byte(0x90 | cc); direct(0, r); }
+    void lea_times5(int r) { // r = r + r*4; r must not be rbp/r13
+        rex(false, r, r, r);
+        byte(0x8D);
+        byte(0x04 | (r & 7) << 3);
+        byte(2 << 6 | (r & 7) << 3 | (r & 7));
+    }
+
+    void load8(int r, int32_t disp) { rex(false, r, 0, 0); byte(0x0F); byte(0xB6); mem(r, disp); }
+    void load8_idx(int r, int index, int32_t disp) { rex(false, r, index, 0); byte(0x0F); byte(0xB6); mem_idx(r, index, 0, disp); }
+    void load16(int r, int32_t disp) { rex(false, r, 0, 0); byte(0x0F); byte(0xB7); mem(r, disp); }
+    void load16_idx(int r, int index, int32_t disp) { rex(false, r, index, 0); byte(0x0F); byte(0xB7); mem_idx(r, index, 1, disp); }
+    void load64_idx(int r, int index, int32_t disp) { rex(true, r, index, 0); byte(0x8B); mem_idx(r, index, 3, disp); }
+    void load8_base_idx(int r, int base, int index) { // r = [base + index]; base must not be rbp/r13
+        rex(false, r, index, base);
+        byte(0x0F);
+        byte(0xB6);
+        byte(0x04 | (r & 7) << 3);
+        byte((index & 7) << 3 | (base & 7));
+    }
+    void load64_table(int r, int table, int index) { // r = [table + index*8]
+        rex(true, r, index, table);
+        byte(0x8B);
+        byte(0x04 | (r & 7) << 3);
+        byte(3 << 6 | (index & 7) << 3 | (table & 7));
+    }
+    void store8(int32_t disp, int r) { rex(false, r, 0, 0, true); byte(0x88); mem(r, disp); }
+    void store16(int32_t disp, int r) { byte(0x66); rex(false, r, 0, 0); byte(0x89); mem(r, disp); }
+    void store16_imm(int32_t disp, uint16_t imm) { byte(0x66); byte(0xC7); mem(0, disp); u16(imm); }
+    void store16_imm_idx(int index, int32_t disp, uint16_t imm) {
+        byte(0x66); rex(false, 0, index, 0); byte(0xC7); mem_idx(0, index, 1, disp); u16(imm);
+    }
+    void add16_imm(int32_t disp, int8_t imm) { byte(0x66); byte(0x83); mem(I_ADD, disp); byte(imm); }
+
+    size_t jmp() { byte(0xE9); size_t at = pos_; u32(0); return at; }
+    size_t jcc(Cond cc) { byte(0x0F); byte(0x80 | cc); size_t at = pos_; u32(0); return at; }
+    void jmp_to(size_t target) { patch(jmp(), target); }
+    void jcc_to(Cond cc, size_t target) { patch(jcc(cc), target); }
+    void jmp_reg(int r) { rex(false, 0, 0, r); byte(0xFF); direct(4, r); }
+    void push(int r) { rex(false, 0, 0, r); byte(0x50 | (r & 7)); }
+    void pop(int r) { rex(false, 0, 0, r); byte(0x58 | (r & 7)); }
+    void ret() { byte(0xC3); }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(target - (at + 4));
+        if (at + 4 <= end_) {
+            std::memcpy(base_ + at, &rel, 4);
+        }
+    }
+
+private:
+    void put(const void* bytes, size_t size) {
+        if (pos_ + size <= end_) {
+            std::memcpy(base_ + pos_, bytes, size);
+        } else {
+            overflowed_ = true;
+        }
+        pos_ += size;
+    }
+
+    uint8_t* base_;
+    size_t pos_;
+    size_t end_;
+    bool overflowed_ = false;
+};
+
+enum class Shape { Straight, Terminator, Interpreted };
+
+Shape shape_of(OpKind kind, const Quirks& quirks) {
+    switch (kind) {
+        case OP_JP: case OP_CALL: case OP_RET: case OP_JP_V0:
+            return Shape::Terminator;
+        // a skip over F000 NNNN is four bytes, known only when it runs
+        case OP_SE_VX_NN: case OP_SNE_VX_NN: case OP_SE_VX_VY: case OP_SNE_VX_VY:
+        case OP_SKP: case OP_SKNP:
+            return quirks.long_skips ? Shape::Interpreted : Shape::Terminator;
+        case OP_SYS: case OP_LD_VX_NN: case OP_ADD_VX_NN: case OP_LD_VX_VY:
+        case OP_OR_VX_VY: case OP_AND_VX_VY: case OP_XOR_VX_VY: case OP_ADD_VX_VY:
+        case OP_SUB: case OP_SHR: case OP_SUBN: case OP_SHL: case OP_LD_I:
+        case OP_LD_VX_DT: case OP_LD_DT_VX: case OP_LD_ST_VX: case OP_ADD_I_VX:
+        case OP_LD_F_VX: case OP_LD_VX_MEM:
+            return Shape::Straight;
+        default:
+            return Shape::Interpreted;
+    }
+}
+
+} // namespace
+
+bool Jit::available() {
+    return true;
+}
+
+Jit::Jit(const Chip8& chip8)
+    : entries_(chip8.code_size(), nullptr), untranslatable_(chip8.code_size(), 0), covered_(chip8.code_size(), 0),
+      rewrites_(chip8.code_size(), 0) {
+    auto offset = [&](const void* field) {
+        return static_cast<int32_t>(static_cast<const char*>(field) - reinterpret_cast<const char*>(&chip8));
+    };
+    off_pc_ = offset(&chip8.pc);
+    off_i_ = offset(&chip8.i_reg);
+    off_sp_ = offset(&chip8.sp);
+    off_dt_ = offset(&chip8.delay_timer);
+    off_st_ = offset(&chip8.sound_timer);
+    off_v_ = offset(chip8.v_regs.data());
+    off_stack_ = offset(chip8.stack.data());
+    off_keypad_ = offset(chip8.keypad.data());
+    off_pages_ = offset(chip8.memory.page_table());
+
+    void* code = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return;
+    }
+    code_ = static_cast<uint8_t*>(code);
+    code_size_ = CODE_SIZE;
+    emit_runtime();
+    set_writable(false);
+}
+
+Jit::~Jit() {
+    if (code_) {
+        munmap(code_, code_size_);
+    }
+}
+
+bool Jit::ready() const {
+    return code_ != nullptr;
+}
+
+// The buffer is never writable and executable at once: it is flipped to
+// read-write while a block is compiled and back to read-execute after.
+void Jit::set_writable(bool writable) {
+    mprotect(code_, code_size_, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC);
+}
+
+// enter / exit glue plus the indirect-jump lookup, at the start of the buffer
+void Jit::emit_runtime() {
+    Emitter e(code_, 0, code_size_);
+    static constexpr Reg saved[] = { RBX, RBP, R12, R13, R14, R15 };
+
+    // int enter(Chip8* rdi, int budget esi, code rdx)
+    for (Reg r : saved) {
+        e.push(r);
+    }
+    e.jmp_reg(RDX);
+
+    // returns the unused budget; pc is already stored
+    epilogue_ = e.pos();
+    e.alu(X_MOV, RAX, RSI);
+    for (int i = 5; i >= 0; --i) {
+        e.pop(saved[i]);
+    }
+    e.ret();
+
+    // eax = new pc (already stored): continue in its block if there is one
+    dispatch_ = e.pos();
+    e.alu_imm(I_CMP, RAX, static_cast<uint32_t>(entries_.size() - 2));
+    e.jcc_to(CC_A, epilogue_);
+    e.mov_imm64(RDX, reinterpret_cast<uint64_t>(entries_.data()));
+    e.load64_table(RDX, RDX, RAX);
+    e.alu(X_TEST, RDX, RDX);
+    e.jcc_to(CC_E, epilogue_);
+    e.jmp_reg(RDX);
+
+    runtime_end_ = code_used_ = e.pos();
+    enter_ = reinterpret_cast<EnterFn>(code_);
+}
+
+void Jit::flush() {
+    if (!code_) {
+        return;
+    }
+    code_used_ = runtime_end_;
+    std::fill(entries_.begin(), entries_.end(), nullptr);
+    std::fill(untranslatable_.begin(), untranslatable_.end(), 0);
+    std::fill(covered_.begin(), covered_.end(), 0);
+    pending_links_.clear();
+}
+
+void Jit::invalidate(uint16_t address) {
+    address &= MEM_SIZE - 1;
+    if (address >= entries_.size()) {
+        return; // past anywhere pc goes
+    }
+    untranslatable_[address] = 0;
+    untranslatable_[(address - 1) & (entries_.size() - 1)] = 0;
+    if (covered_[address]) {
+        if (rewrites_[address] < SELF_MODIFYING) {
+            ++rewrites_[address];
+        }
+        flush(); // blocks are chained into each other, so drop them all
+    }
+}
+
+const uint8_t* Jit::block_at(const Chip8& chip8, uint16_t address) {
+    if (address >= entries_.size() - 1 || untranslatable_[address]) {
+        return nullptr;
+    }
+    if (!entries_[address]) {
+        set_writable(true);
+        entries_[address] = compile(chip8, address);
+        set_writable(false);
+        untranslatable_[address] = entries_[address] == nullptr;
+    }
+    return entries_[address];
+}
+
+const uint8_t* Jit::compile(const Chip8& chip8, uint16_t start) {
+    struct Item {
+        uint16_t address;
+        DecodedOp op;
+    };
+    Item items[MAX_BLOCK_OPS];
+    size_t count = 0;
+    int host[NUM_REGISTERS];
+    std::fill(std::begin(host), std::end(host), -1);
+    uint16_t allocated = 0;
+    int pool_used = 0;
+    bool terminated = false;
+    // the profile is fixed per translation; changing it flushes them all
+    const Quirks& quirks = QUIRK_PROFILES[chip8.quirks];
+
+    // pick the ops: straight-line code up to a branch, an interpreter-only
+    // op, or running out of host registers
+    uint32_t address = start;
+    while (count < MAX_BLOCK_OPS && address < entries_.size() - 1) {
+        DecodedOp op = decode_opcode((chip8.memory[address] << 8) | chip8.memory[address + 1]);
+        Shape shape = shape_of(op.kind, quirks);
+        if (shape == Shape::Interpreted) {
+            break;
+        }
+        // code the ROM keeps rewriting isn't worth translating again
+        if (rewrites_[address] >= SELF_MODIFYING || rewrites_[address + 1] >= SELF_MODIFYING) {
+            break;
+        }
+        uint16_t fresh = registers_touched(op, quirks) & ~allocated;
+        if (pool_used + __builtin_popcount(fresh) > POOL_SIZE) {
+            break;
+        }
+        for (int v = 0; v < static_cast<int>(NUM_REGISTERS); ++v) {
+            if (fresh & (1 << v)) {
+                host[v] = guest_pool[pool_used++];
+            }
+        }
+        allocated |= fresh;
+        items[count++] = {static_cast<uint16_t>(address), op};
+        address += 2;
+        if (shape == Shape::Terminator) {
+            terminated = true;
+            break;
+        }
+    }
+    if (count == 0) {
+        return nullptr;
+    }
+
+    const size_t links_before = pending_links_.size();
+    Emitter e(code_, code_used_, code_size_);
+    const size_t entry = e.pos();
+    uint16_t dirty = 0;
+
+    auto V = [&](int v) { return host[v]; };
+    auto write = [&](int v) { dirty |= 1 << v; return host[v]; };
+    auto store_dirty = [&]() {
+        for (int v = 0; v < static_cast<int>(NUM_REGISTERS); ++v) {
+            if (dirty & (1 << v)) {
+                e.store8(off_v_ + v, host[v]);
+            }
+        }
+    };
+    // leave the block for `target`, through a jump that gets pointed
+    // straight at target's block once that exists
+    auto exit_to = [&](uint16_t target) {
+        size_t site = e.jmp();
+        e.patch(site, e.pos());
+        e.store16_imm(off_pc_, target);
+        e.jmp_to(epilogue_);
+        if (target < entries_.size() - 1) {
+            if (entries_[target]) {
+                e.patch(site, entries_[target] - code_);
+            } else {
+                pending_links_.push_back({target, site});
+            }
+        }
+    };
+
+    // not enough budget left for the whole block: let the interpreter finish
+    e.alu_imm(I_CMP, RSI, count);
+    size_t bail = e.jcc(CC_L);
+    e.alu_imm(I_SUB, RSI, count);
+    for (int v = 0; v < static_cast<int>(NUM_REGISTERS); ++v) {
+        if (allocated & (1 << v)) {
+            e.load8(host[v], off_v_ + v);
+        }
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        const DecodedOp& op = items[k].op;
+        const uint16_t at = items[k].address;
+        switch (op.kind) {
+            case OP_SYS:
+                break;
+            case OP_LD_VX_NN:
+                e.mov_imm(write(op.x), op.nn);
+                break;
+            case OP_ADD_VX_NN:
+                e.alu_imm(I_ADD, write(op.x), op.nn);
+                e.alu_imm(I_AND, V(op.x), 0xFF);
+                break;
+            case OP_LD_VX_VY:
+                e.alu(X_MOV, write(op.x), V(op.y));
+                break;
+            case OP_OR_VX_VY:
+                e.alu(X_OR, write(op.x), V(op.y));
+                if (quirks.logic_resets_vf) {
+                    e.mov_imm(write(0xF), 0);
+                }
+                break;
+            case OP_AND_VX_VY:
+                e.alu(X_AND, write(op.x), V(op.y));
+                if (quirks.logic_resets_vf) {
+                    e.mov_imm(write(0xF), 0);
+                }
+                break;
+            case OP_XOR_VX_VY:
+                e.alu(X_XOR, write(op.x), V(op.y));
+                if (quirks.logic_resets_vf) {
+                    e.mov_imm(write(0xF), 0);
+                }
+                break;
+            case OP_ADD_VX_VY:
+                e.alu(X_MOV, RAX, V(op.x));
+                e.alu(X_ADD, RAX, V(op.y));
+                e.alu(X_MOV, RCX, RAX);
+                e.shift(S_SHR, RCX, 8);
+                e.alu_imm(I_AND, RAX, 0xFF);
+                e.alu(X_MOV, write(op.x), RAX);
+                e.alu(X_MOV, write(0xF), RCX);
+                break;
+            case OP_SUB:
+            case OP_SUBN: {
+                int lhs = op.kind == OP_SUB ? V(op.x) : V(op.y);
+                int rhs = op.kind == OP_SUB ? V(op.y) : V(op.x);
+                e.alu(X_XOR, RCX, RCX);
+                e.alu(X_CMP, lhs, rhs);
+                e.setcc(CC_AE, RCX);
+                e.alu(X_MOV, RAX, lhs);
+                e.alu(X_SUB, RAX, rhs);
+                e.alu_imm(I_AND, RAX, 0xFF);
+                e.alu(X_MOV, write(op.x), RAX);
+                e.alu(X_MOV, write(0xF), RCX);
+                break;
+            }
+            case OP_SHR:
+                e.alu(X_MOV, RAX, V(quirks.shift_vx ? op.x : op.y));
+                e.alu(X_MOV, RCX, RAX);
+                e.alu_imm(I_AND, RCX, 1);
+                e.shift(S_SHR, RAX, 1);
+                e.alu(X_MOV, write(op.x), RAX);
+                e.alu(X_MOV, write(0xF), RCX);
+                break;
+            case OP_SHL:
+                e.alu(X_MOV, RAX, V(quirks.shift_vx ? op.x : op.y));
+                e.alu(X_MOV, RCX, RAX);
+                e.shift(S_SHR, RCX, 7);
+                e.shift(S_SHL, RAX, 1);
+                e.alu_imm(I_AND, RAX, 0xFF);
+                e.alu(X_MOV, write(op.x), RAX);
+                e.alu(X_MOV, write(0xF), RCX);
+                break;
+            case OP_LD_I:
+                e.store16_imm(off_i_, op.nnn);
+                break;
+            case OP_LD_VX_DT:
+                e.load8(write(op.x), off_dt_);
+                break;
+            case OP_LD_DT_VX:
+                e.store8(off_dt_, V(op.x));
+                break;
+            case OP_LD_ST_VX:
+                e.store8(off_st_, V(op.x));
+                break;
+            case OP_ADD_I_VX:
+                e.load16(RAX, off_i_);
+                e.alu(X_ADD, RAX, V(op.x));
+                e.alu_imm(I_AND, RAX, 0xFFFF);
+                e.store16(off_i_, RAX);
+                if (quirks.index_overflow_vf) {
+                    e.alu(X_XOR, RCX, RCX);
+                    e.alu_imm(I_CMP, RAX, 0xFFF);
+                    e.setcc(CC_A, RCX);
+                    e.alu(X_MOV, write(0xF), RCX);
+                }
+                break;
+            case OP_LD_F_VX:
+                e.alu(X_MOV, RAX, V(op.x));
+                e.lea_times5(RAX);
+                e.alu_imm(I_ADD, RAX, FONTSET_START_ADDRESS);
+                e.store16(off_i_, RAX);
+                break;
+            case OP_LD_VX_MEM: {
+                e.load16(RAX, off_i_);
+                // the machine's page table only covers the first 4 KB; a
+                // read reaching past it leaves the block here, with this
+                // op and the rest of the block's budget handed back, and
+                // the interpreter runs it
+                e.alu_imm(I_CMP, RAX, CLASSIC_MEM_SIZE - op.x);
+                size_t low = e.jcc(CC_B);
+                store_dirty();
+                e.alu_imm(I_ADD, RSI, static_cast<uint32_t>(count - k));
+                e.store16_imm(off_pc_, at);
+                e.jmp_to(epilogue_);
+                e.patch(low, e.pos());
+                // through the page table: rdx = page, ecx = offset in it
+                static_assert(MEMORY_PAGE_SIZE == 256);
+                for (int v = 0; v <= op.x; ++v) {
+                    e.alu(X_MOV, RCX, RAX);
+                    e.alu_imm(I_ADD, RCX, v);
+                    e.alu(X_MOV, RDX, RCX);
+                    e.shift(S_SHR, RDX, 8);
+                    e.load64_idx(RDX, RDX, off_pages_);
+                    e.alu_imm(I_AND, RCX, MEMORY_PAGE_SIZE - 1);
+                    e.load8_base_idx(write(v), RDX, RCX);
+                }
+                if (quirks.index_after_store != INDEX_UNCHANGED) {
+                    e.alu_imm(I_ADD, RAX, quirks.index_after_store == INDEX_PAST_LAST ? op.x + 1 : op.x);
+                    e.store16(off_i_, RAX);
+                }
+                break;
+            }
+
+            // terminators: flush registers, then leave
+            case OP_JP:
+                store_dirty();
+                exit_to(op.nnn);
+                break;
+            case OP_CALL: {
+                store_dirty();
+                e.load16(RAX, off_sp_);
+                e.alu_imm(I_CMP, RAX, STACK_SIZE);
+                size_t overflow = e.jcc(CC_AE);
+                e.store16_imm_idx(RAX, off_stack_, at + 2);
+                e.add16_imm(off_sp_, 1);
+                exit_to(op.nnn);
+                // full stack: the interpreter reports it
+                e.patch(overflow, e.pos());
+                e.alu_imm(I_ADD, RSI, 1);
+                e.store16_imm(off_pc_, at);
+                e.jmp_to(epilogue_);
+                break;
+            }
+            case OP_RET: {
+                store_dirty();
+                e.load16(RAX, off_sp_);
+                e.alu(X_TEST, RAX, RAX);
+                size_t underflow = e.jcc(CC_E);
+                e.alu_imm(I_SUB, RAX, 1);
+                e.store16(off_sp_, RAX);
+                e.load16_idx(RAX, RAX, off_stack_);
+                e.store16(off_pc_, RAX);
+                e.jmp_to(dispatch_);
+                // empty stack: give the op back and let the interpreter complain
+                e.patch(underflow, e.pos());
+                e.alu_imm(I_ADD, RSI, 1);
+                e.store16_imm(off_pc_, at);
+                e.jmp_to(epilogue_);
+                break;
+            }
+            case OP_JP_V0:
+                store_dirty();
+                e.alu(X_MOV, RAX, V(quirks.jump_vx ? op.x : 0));
+                e.alu_imm(I_ADD, RAX, op.nnn);
+                e.store16(off_pc_, RAX);
+                e.jmp_to(dispatch_);
+                break;
+            case OP_SE_VX_NN:
+            case OP_SNE_VX_NN:
+            case OP_SE_VX_VY:
+            case OP_SNE_VX_VY:
+            case OP_SKP:
+            case OP_SKNP: {
+                store_dirty();
+                Cond skip_if = CC_E;
+                if (op.kind == OP_SE_VX_NN || op.kind == OP_SNE_VX_NN) {
+                    e.alu_imm(I_CMP, V(op.x), op.nn);
+                    skip_if = op.kind == OP_SE_VX_NN ? CC_E : CC_NE;
+                } else if (op.kind == OP_SE_VX_VY || op.kind == OP_SNE_VX_VY) {
+                    e.alu(X_CMP, V(op.x), V(op.y));
+                    skip_if = op.kind == OP_SE_VX_VY ? CC_E : CC_NE;
+                } else {
+                    e.alu(X_MOV, RCX, V(op.x));
+                    e.alu_imm(I_AND, RCX, 0xF);
+                    e.load8_idx(RAX, RCX, off_keypad_);
+                    e.alu(X_TEST, RAX, RAX);
+                    skip_if = op.kind == OP_SKP ? CC_NE : CC_E;
+                }
+                size_t skip = e.jcc(skip_if);
+                exit_to(at + 2);
+                e.patch(skip, e.pos());
+                exit_to(at + 4);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    if (!terminated) {
+        store_dirty();
+        exit_to(address);
+    }
+
+    e.patch(bail, e.pos());
+    e.store16_imm(off_pc_, start);
+    e.jmp_to(epilogue_);
+
+    // out of buffer: start it over and try again, once; a block that
+    // doesn't fit even then is left to the interpreter
+    if (e.overflowed()) {
+        pending_links_.resize(links_before);
+        if (code_used_ == runtime_end_) {
+            return nullptr;
+        }
+        flush();
+        return compile(chip8, start);
+    }
+
+    code_used_ = e.pos();
+    const uint8_t* block = code_ + entry;
+    std::fill(covered_.begin() + start, covered_.begin() + address, 1);
+
+    // anything that was waiting to jump here can now do so directly
+    auto waiting = std::remove_if(pending_links_.begin(), pending_links_.end(), [&](const auto& link) {
+        if (link.first != start) {
+            return false;
+        }
+        Emitter(code_, 0, code_size_).patch(link.second, entry);
+        return true;
+    });
+    pending_links_.erase(waiting, pending_links_.end());
+    return block;
+}
+
+void Jit::run(Chip8& chip8, int count) {
+    int remaining = count;
+    while (remaining > 0) {
+        const uint8_t* block = block_at(chip8, chip8.pc);
+        if (block) {
+            int left = enter_(&chip8, remaining, block);
+            if (left != remaining) {
+                chip8.cycles += remaining - left;
+                remaining = left;
+                continue;
+            }
+        }
+        // no translation here (or not enough budget for one): single-step
+        chip8.interpret(1);
+        --remaining;
+    }
+}
+
+#else // no native code generation on this host
+
+bool Jit::available() {
+    return false;
+}
+
+Jit::Jit(const Chip8&) {}
+Jit::~Jit() {}
+
+bool Jit::ready() const {
+    return false;
+}
+
+void Jit::emit_runtime() {}
+void Jit::set_writable(bool) {}
+void Jit::flush() {}
+void Jit::invalidate(uint16_t) {}
+
+const uint8_t* Jit::block_at(const Chip8&, uint16_t) {
+    return nullptr;
+}
+
+const uint8_t* Jit::compile(const Chip8&, uint16_t) {
+    return nullptr;
+}
+
+void Jit::run(Chip8& chip8, int count) {
+    chip8.interpret(count);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef JIT_H
+#define JIT_H
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct Chip8;
+
+// Dynamic recompiler: translates straight-line runs of CHIP-8 code starting
+// at pc into x86-64 and chains blocks together on direct jumps. Anything it
+// can't (or shouldn't) translate - DXYN, FX0A, CXNN, 00E0 and the stores
+// that may hit code (FX33/FX55) - runs through the interpreter instead, so
+// results match Chip8::interpret() exactly.
+class Jit {
+public:
+    // false on hosts where no native code can be generated
+    static bool available();
+
+    explicit Jit(const Chip8& chip8);
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // false if no executable memory could be had
+    bool ready() const;
+
+    // executes exactly `count` instructions
+    void run(Chip8& chip8, int count);
+
+    // memory at `address` changed; drops translations that covered it
+    void invalidate(uint16_t address);
+    void flush();
+    // addresses the per-address tables cover: the machine's code_size()
+    // when the recompiler was made
+    size_t address_space() const { return entries_.size(); }
+
+private:
+    using EnterFn = int (*)(Chip8*, int, const uint8_t*);
+
+    const uint8_t* block_at(const Chip8& chip8, uint16_t address);
+    const uint8_t* compile(const Chip8& chip8, uint16_t address);
+    void emit_runtime();
+    void set_writable(bool writable);
+
+    uint8_t* code_ = nullptr;
+    size_t code_size_ = 0;
+    size_t code_used_ = 0;
+    size_t runtime_end_ = 0;
+    EnterFn enter_ = nullptr;
+    size_t epilogue_ = 0;       // offsets into code_
+    size_t dispatch_ = 0;
+
+    std::vector<const uint8_t*> entries_;   // block entry per address pc reaches
+    std::vector<uint8_t> untranslatable_;   // address starts with an interpreter-only op
+    std::vector<uint8_t> covered_;          // bytes some block was translated from
+    std::vector<uint8_t> rewrites_;         // times a store has hit translated code here
+    std::vector<std::pair<uint16_t, size_t>> pending_links_; // (target, rel32 offset)
+
+    // byte offsets of Chip8 fields, taken from a live instance
+    int32_t off_pc_, off_i_, off_sp_, off_dt_, off_st_, off_v_, off_stack_, off_keypad_, off_pages_;
+};
+
+#endif // JIT_H
@@ -0,0 +1,1199 @@
+#include "chip8.h"
+#include "debugger.h"
+#include "profiler.h"
+#include "replay.h"
+#include "trace.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// Opcodes are decoded once per address into decode_cache and then executed
+// straight from there. Each handler does one instruction; `pc` already points
+// at the next one when it runs and is passed separately so the dispatch loop
+// can keep it in a register. Handlers for the ambiguous opcodes are
+// templates on the quirk profile (see quirks.h), resolved at compile time.
+using OpHandler = void (*)(Chip8&, const DecodedOp&, uint16_t& pc);
+
+DecodedOp decode_opcode(uint16_t opcode) {
+    DecodedOp op;
+    op.x = (opcode & 0x0F00) >> 8;
+    op.y = (opcode & 0x00F0) >> 4;
+    op.n = opcode & 0x000F;
+    op.nn = opcode & 0x00FF;
+    op.nnn = opcode & 0x0FFF;
+    op.kind = OP_UNKNOWN;
+
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            switch (opcode) {
+                case 0x00E0: op.kind = OP_CLS; break;
+                case 0x00EE: op.kind = OP_RET; break;
+                case 0x00FB: op.kind = OP_SCR; break;
+                case 0x00FC: op.kind = OP_SCL; break;
+                case 0x00FD: op.kind = OP_EXIT; break;
+                case 0x00FE: op.kind = OP_LOW; break;
+                case 0x00FF: op.kind = OP_HIGH; break;
+                default:
+                    if ((opcode & 0xFFF0) == 0x00C0) {
+                        op.kind = OP_SCD;
+                    } else if ((opcode & 0xFFF0) == 0x00D0) {
+                        op.kind = OP_SCU;
+                    } else {
+                        op.kind = OP_SYS;
+                    }
+                    break;
+            }
+            break;
+        case 0x1000: op.kind = OP_JP; break;
+        case 0x2000: op.kind = OP_CALL; break;
+        case 0x3000: op.kind = OP_SE_VX_NN; break;
+        case 0x4000: op.kind = OP_SNE_VX_NN; break;
+        case 0x5000:
+            switch (op.n) {
+                case 0x2: op.kind = OP_SAVE_RANGE; break;
+                case 0x3: op.kind = OP_LOAD_RANGE; break;
+                default: op.kind = OP_SE_VX_VY; break;
+            }
+            break;
+        case 0x6000: op.kind = OP_LD_VX_NN; break;
+        case 0x7000: op.kind = OP_ADD_VX_NN; break;
+        case 0x8000: // arithmetic opcodes
+            switch (op.n) {
+                case 0x0: op.kind = OP_LD_VX_VY; break;
+                case 0x1: op.kind = OP_OR_VX_VY; break;
+                case 0x2: op.kind = OP_AND_VX_VY; break;
+                case 0x3: op.kind = OP_XOR_VX_VY; break;
+                case 0x4: op.kind = OP_ADD_VX_VY; break;
+                case 0x5: op.kind = OP_SUB; break;
+                case 0x6: op.kind = OP_SHR; break;
+                case 0x7: op.kind = OP_SUBN; break;
+                case 0xE: op.kind = OP_SHL; break;
+            }
+            break;
+        case 0x9000: op.kind = OP_SNE_VX_VY; break;
+        case 0xA000: op.kind = OP_LD_I; break;
+        case 0xB000: op.kind = OP_JP_V0; break;
+        case 0xC000: op.kind = OP_RND; break;
+        case 0xD000: op.kind = OP_DRW; break;
+        case 0xE000:
+            switch (op.nn) {
+                case 0x9E: op.kind = OP_SKP; break;
+                case 0xA1: op.kind = OP_SKNP; break;
+            }
+            break;
+        case 0xF000:
+            switch (op.nn) {
+                case 0x00:
+                    if (op.x == 0) {
+                        op.kind = OP_LD_I_LONG;
+                    }
+                    break;
+                case 0x01: op.kind = OP_PLANE; break;
+                case 0x02:
+                    if (op.x == 0) {
+                        op.kind = OP_AUDIO;
+                    }
+                    break;
+                case 0x07: op.kind = OP_LD_VX_DT; break;
+                case 0x0A: op.kind = OP_LD_VX_K; break;
+                case 0x15: op.kind = OP_LD_DT_VX; break;
+                case 0x18: op.kind = OP_LD_ST_VX; break;
+                case 0x1E: op.kind = OP_ADD_I_VX; break;
+                case 0x29: op.kind = OP_LD_F_VX; break;
+                case 0x30: op.kind = OP_LD_HF_VX; break;
+                case 0x33: op.kind = OP_LD_B_VX; break;
+                case 0x3A: op.kind = OP_LD_PITCH_VX; break;
+                case 0x55: op.kind = OP_LD_MEM_VX; break;
+                case 0x65: op.kind = OP_LD_VX_MEM; break;
+                case 0x75: op.kind = OP_SAVE_FLAGS; break;
+                case 0x85: op.kind = OP_LOAD_FLAGS; break;
+            }
+            break;
+    }
+    return op;
+}
+
+uint16_t registers_touched(const DecodedOp& op, const Quirks& quirks) {
+    const uint16_t x = 1 << op.x, y = 1 << op.y, vf = 1 << 0xF;
+    switch (first_op(op.kind)) {
+        case OP_OR_VX_VY: case OP_AND_VX_VY: case OP_XOR_VX_VY:
+            return quirks.logic_resets_vf ? x | y | vf : x | y;
+        case OP_LD_VX_NN: case OP_ADD_VX_NN: case OP_LD_VX_DT: case OP_LD_DT_VX:
+        case OP_LD_ST_VX: case OP_LD_F_VX: case OP_SE_VX_NN: case OP_SNE_VX_NN: case OP_LD_PITCH_VX:
+        case OP_LD_HF_VX:
+        case OP_SKP: case OP_SKNP: case OP_RND: case OP_LD_VX_K: case OP_LD_B_VX:
+            return x;
+        case OP_LD_VX_VY: case OP_SE_VX_VY: case OP_SNE_VX_VY:
+            return x | y;
+        case OP_ADD_VX_VY: case OP_SUB: case OP_SHR: case OP_SUBN: case OP_SHL: case OP_DRW:
+            return x | y | vf;
+        case OP_ADD_I_VX:
+            return x | vf;
+        case OP_LD_MEM_VX: case OP_LD_VX_MEM: case OP_SAVE_FLAGS: case OP_LOAD_FLAGS:
+            return static_cast<uint16_t>((2u << op.x) - 1);
+        case OP_SAVE_RANGE: case OP_LOAD_RANGE: {
+            const int low = std::min(op.x, op.y), high = std::max(op.x, op.y);
+            return static_cast<uint16_t>((2u << high) - (1u << low));
+        }
+        case OP_JP_V0:
+            return quirks.jump_vx ? x : 1;
+        default:
+            return 0;
+    }
+}
+
+// The idioms are the ones nearly every ROM is built from: set I and draw,
+// set both sprite coordinates, poll the delay timer, bump and test a loop
+// counter (the profiler's pair counts show which ones a ROM leans on).
+// Only the first slot is replaced; the slots after it keep their own ops,
+// so jumping into the middle still works.
+bool fuses(OpKind first, OpKind second) {
+    return (first == OP_LD_I && second == OP_DRW) ||
+           (first == OP_LD_VX_NN && second == OP_LD_VX_NN) ||
+           (first == OP_LD_VX_DT && second == OP_SE_VX_NN) ||
+           (first == OP_ADD_VX_NN && second == OP_SE_VX_NN);
+}
+
+DecodedOp fuse_ops(const DecodedOp& first, uint16_t second, uint16_t third) {
+    const DecodedOp next = decode_opcode(second);
+    if (!fuses(first.kind, next.kind)) {
+        return first;
+    }
+    DecodedOp fused = first;
+    switch (first.kind) {
+        case OP_LD_I:
+            fused.kind = OP_LD_I_DRW;
+            fused.x = next.x;
+            fused.y = next.y;
+            fused.n = next.n;
+            break;
+        case OP_LD_VX_NN:
+            fused.kind = OP_LD_VX_VY_NN;
+            fused.y = next.x;
+            fused.n = next.nn;
+            break;
+        case OP_LD_VX_DT:
+            if ((third & 0xF000) != 0x1000) {
+                return first;
+            }
+            fused.kind = OP_WAIT_DT;
+            fused.y = next.x;
+            fused.n = next.nn;
+            fused.nnn = third & 0x0FFF;
+            break;
+        default: // OP_ADD_VX_NN
+            if (third == 0xF000) {
+                return first; // how far the skip goes depends on the profile
+            }
+            fused.kind = OP_ADD_SE;
+            fused.y = next.x;
+            fused.n = next.nn;
+            break;
+    }
+    return fused;
+}
+
+namespace {
+
+// `mask` is code_size() - 1: an instruction at the last address pc
+// reaches takes its second byte from address 0
+inline DecodedOp decode_at(const Chip8& c, uint16_t at, uint16_t mask) {
+    return decode_opcode((c.memory[at & mask] << 8) | c.memory[(at + 1) & mask]);
+}
+
+// What an op is worth a record for beyond TRACE_CPU, judged before it
+// runs: false for most. Only the traced loops ask, so the handlers never
+// look at the tracer and the fast paths pay nothing for tracing.
+bool trace_event(const Chip8& c, const DecodedOp& op, uint16_t at, TraceCategory& category, TraceLevel& level) {
+    switch (op.kind) {
+    case OP_UNKNOWN:
+        category = TRACE_ERROR;
+        level = TRACE_LEVEL_ERROR;
+        return true;
+    case OP_RET:
+        category = TRACE_ERROR;
+        level = TRACE_LEVEL_ERROR;
+        return c.sp == 0; // stack underflow, huh?
+    case OP_CALL:
+        category = TRACE_ERROR;
+        level = TRACE_LEVEL_ERROR;
+        return c.sp >= STACK_SIZE; // stack overflow, whoa
+    case OP_JP:
+        category = TRACE_FLOW;
+        level = TRACE_LEVEL_INFO;
+        return op.nnn == at; // jumps to itself, infinite loop
+    case OP_EXIT:
+        category = TRACE_FLOW;
+        level = TRACE_LEVEL_INFO;
+        return true;
+    case OP_CLS:
+    case OP_DRW:
+    case OP_SCD:
+    case OP_SCU:
+    case OP_SCR:
+    case OP_SCL:
+    case OP_LOW:
+    case OP_HIGH:
+        category = TRACE_DRAW;
+        level = TRACE_LEVEL_INFO;
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline void op_unknown(Chip8&, const DecodedOp&, uint16_t&) {}
+
+inline void op_sys(Chip8&, const DecodedOp&, uint16_t&) {}
+
+inline void op_cls(Chip8& c, const DecodedOp&, uint16_t&) {  // Clear screen
+    c.clear_screen();
+}
+
+inline void op_ret(Chip8& c, const DecodedOp&, uint16_t& pc) {
+    if (c.sp > 0) {
+        --c.sp;
+        pc = c.stack[c.sp];
+    }
+}
+
+inline void op_jp(Chip8&, const DecodedOp& op, uint16_t& pc) {
+    pc = op.nnn;
+}
+
+inline void op_call(Chip8& c, const DecodedOp& op, uint16_t& pc) {  // ring ring subroutine at NNN
+    if (c.sp >= STACK_SIZE) {
+        return;
+    }
+    c.stack[c.sp] = pc;
+    c.sp++;
+    pc = op.nnn;
+}
+
+// past the next instruction, F000 NNNN and all where the profile says so
+template <Quirks Q>
+inline void skip(const Chip8& c, uint16_t& pc) {
+    if constexpr (Q.long_skips) {
+        if (c.memory[pc] == 0xF0 && c.memory[pc + 1] == 0x00) {
+            pc += 2;
+        }
+    }
+    pc += 2;
+}
+
+template <Quirks Q>
+inline void op_se_vx_nn(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (c.v_regs[op.x] == op.nn) {
+        skip<Q>(c, pc);
+    }
+}
+
+template <Quirks Q>
+inline void op_sne_vx_nn(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (c.v_regs[op.x] != op.nn) {
+        skip<Q>(c, pc);
+    }
+}
+
+template <Quirks Q>
+inline void op_se_vx_vy(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (c.v_regs[op.x] == c.v_regs[op.y]) {
+        skip<Q>(c, pc);
+    }
+}
+
+inline void op_ld_vx_nn(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] = op.nn;
+}
+
+inline void op_add_vx_nn(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] += op.nn;
+}
+
+inline void op_ld_vx_vy(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] = c.v_regs[op.y];
+}
+
+template <Quirks Q>
+inline void op_or_vx_vy(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] |= c.v_regs[op.y];
+    if constexpr (Q.logic_resets_vf) {
+        c.v_regs[0xF] = 0;
+    }
+}
+
+template <Quirks Q>
+inline void op_and_vx_vy(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] &= c.v_regs[op.y];
+    if constexpr (Q.logic_resets_vf) {
+        c.v_regs[0xF] = 0;
+    }
+}
+
+template <Quirks Q>
+inline void op_xor_vx_vy(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] ^= c.v_regs[op.y];
+    if constexpr (Q.logic_resets_vf) {
+        c.v_regs[0xF] = 0;
+    }
+}
+
+inline void op_add_vx_vy(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint16_t result = c.v_regs[op.x] + c.v_regs[op.y];
+    c.v_regs[op.x] = static_cast<uint8_t>(result);
+    c.v_regs[0xF] = (result > 0xFF) ? 1 : 0;
+}
+
+inline void op_sub(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint8_t vx = c.v_regs[op.x];
+    uint8_t vy = c.v_regs[op.y];
+    c.v_regs[op.x] = vx - vy;
+    c.v_regs[0xF] = (vx >= vy) ? 1 : 0;
+}
+
+template <Quirks Q>
+inline void op_shr(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint8_t val = c.v_regs[Q.shift_vx ? op.x : op.y];
+    c.v_regs[op.x] = val >> 1;
+    c.v_regs[0xF] = val & 0x1;
+}
+
+inline void op_subn(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint8_t vx = c.v_regs[op.x];
+    uint8_t vy = c.v_regs[op.y];
+    c.v_regs[op.x] = vy - vx;
+    c.v_regs[0xF] = (vy >= vx) ? 1 : 0;
+}
+
+template <Quirks Q>
+inline void op_shl(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint8_t val = c.v_regs[Q.shift_vx ? op.x : op.y];
+    c.v_regs[op.x] = val << 1;
+    c.v_regs[0xF] = (val & 0x80) >> 7;
+}
+
+template <Quirks Q>
+inline void op_sne_vx_vy(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (c.v_regs[op.x] != c.v_regs[op.y]) {
+        skip<Q>(c, pc);
+    }
+}
+
+inline void op_ld_i(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.i_reg = op.nnn;
+}
+
+template <Quirks Q>
+inline void op_jp_v0(Chip8& c, const DecodedOp& op, uint16_t& pc) {  // Jump with offset
+    pc = op.nnn + c.v_regs[Q.jump_vx ? op.x : 0];
+}
+
+inline void op_rnd(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] = c.next_random() & op.nn;
+}
+
+// `bits`, `width` pixels with the leftmost in the top bit, at column x of a
+// hires row, as the row's two words; with WRAP what passes the right edge
+// comes back in at the left
+template <bool WRAP>
+inline Framebuffer::Row place_hires(uint32_t bits, unsigned width, unsigned x) {
+    const uint64_t left = static_cast<uint64_t>(bits) << (64 - width);
+    if (x < 64) {
+        return {left >> x, x ? left << (64 - x) : 0};
+    }
+    const unsigned shift = x - 64;
+    const uint64_t spill = shift ? left << (64 - shift) : 0;
+    return {WRAP ? spill : 0, left >> shift};
+}
+
+// each sprite row is shifted into place (rotated, when it wraps round the
+// right edge), then XORed and collision-tested against the whole screen
+// row at once; a lores row is one word, as it always was
+template <bool CLIP, ZeroHeightSprite ZERO>
+void draw(Chip8& c, uint8_t x, uint8_t y, uint8_t height) {
+    Framebuffer& fb = c.screen;
+    const unsigned rows = fb.height();
+    const unsigned left = x % fb.width();
+    const unsigned top = y % rows;
+    const unsigned sprite_width = height || ZERO == SPRITE0_8X16 ? 8 : 16;
+    const unsigned sprite_rows = height ? height : ZERO == SPRITE0_NONE ? 0 : 16;
+    const unsigned row_bytes = sprite_width / 8;
+    uint16_t address = c.i_reg;
+    uint64_t collided = 0;
+
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (!(c.planes & (1 << p))) {
+            continue;
+        }
+        Framebuffer::Plane& plane = fb.planes[p];
+        for (unsigned row = 0; row < sprite_rows; ++row, address += row_bytes) {
+            if (CLIP && top + row >= rows) {
+                address += (sprite_rows - row) * row_bytes; // the next plane's rows
+                break;
+            }
+            uint32_t bits = c.memory[address];
+            if (row_bytes == 2) {
+                bits = bits << 8 | c.memory[address + 1];
+            }
+            Framebuffer::Row& line = plane[(top + row) % rows];
+            if (fb.hires) {
+                const Framebuffer::Row placed = place_hires<!CLIP>(bits, sprite_width, left);
+                collided |= (line[0] & placed[0]) | (line[1] & placed[1]);
+                line[0] ^= placed[0];
+                line[1] ^= placed[1];
+            } else {
+                const uint64_t shifted = static_cast<uint64_t>(bits) << (64 - sprite_width);
+                const uint64_t placed = CLIP ? shifted >> left : std::rotr(shifted, left);
+                collided |= line[0] & placed;
+                line[0] ^= placed;
+            }
+        }
+    }
+    c.v_regs[0xF] = collided != 0;
+}
+
+template <Quirks Q>
+inline void op_drw(Chip8& c, const DecodedOp& op, uint16_t&) {
+    draw<Q.clip_sprites, Q.zero_height>(c, c.v_regs[op.x], c.v_regs[op.y], op.n);
+}
+
+template <Quirks Q>
+inline void op_skp(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (c.keypad[c.v_regs[op.x] & 0xF]) {
+        skip<Q>(c, pc);
+    }
+}
+
+template <Quirks Q>
+inline void op_sknp(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    if (!c.keypad[c.v_regs[op.x] & 0xF]) {
+        skip<Q>(c, pc);
+    }
+}
+
+inline void op_ld_vx_dt(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.v_regs[op.x] = c.delay_timer;
+}
+
+inline void op_ld_vx_k(Chip8& c, const DecodedOp& op, uint16_t& pc) {
+    for (uint8_t i = 0; i < NUM_KEYS; i++) {
+        if (c.keypad[i]) {
+            c.v_regs[op.x] = i;
+            return;
+        }
+    }
+    pc -= 2; // no key yet, run this again
+}
+
+inline void op_ld_dt_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.delay_timer = c.v_regs[op.x];
+}
+
+inline void op_ld_st_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.sound_timer = c.v_regs[op.x];
+}
+
+template <Quirks Q>
+inline void op_add_i_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.i_reg += c.v_regs[op.x];
+    if constexpr (Q.index_overflow_vf) {
+        c.v_regs[0xF] = (c.i_reg > 0xFFF) ? 1 : 0;
+    }
+}
+
+inline void op_ld_f_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.i_reg = FONTSET_START_ADDRESS + (c.v_regs[op.x] * 5);
+}
+
+inline void op_ld_b_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    uint8_t value = c.v_regs[op.x];
+    c.write_memory(c.i_reg, value / 100);
+    c.write_memory(c.i_reg + 1, (value / 10) % 10);
+    c.write_memory(c.i_reg + 2, value % 10);
+}
+
+template <Quirks Q>
+inline void advance_index(Chip8& c, uint8_t x) {
+    if constexpr (Q.index_after_store == INDEX_PAST_LAST) {
+        c.i_reg += x + 1;
+    } else if constexpr (Q.index_after_store == INDEX_AT_LAST) {
+        c.i_reg += x;
+    }
+}
+
+template <Quirks Q>
+inline void op_ld_mem_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    for (int i = 0; i <= op.x; ++i) {
+        c.write_memory(c.i_reg + i, c.v_regs[i]);
+    }
+    advance_index<Q>(c, op.x);
+}
+
+template <Quirks Q>
+inline void op_ld_vx_mem(Chip8& c, const DecodedOp& op, uint16_t&) {
+    for (int i = 0; i <= op.x; ++i) {
+        c.v_regs[i] = c.memory[(c.i_reg + i) & (MEM_SIZE - 1)];
+    }
+    advance_index<Q>(c, op.x);
+}
+
+inline void op_audio(Chip8& c, const DecodedOp&, uint16_t&) {
+    for (size_t i = 0; i < AUDIO_PATTERN_SIZE; ++i) {
+        c.audio_pattern[i] = c.memory[(c.i_reg + i) & (MEM_SIZE - 1)];
+    }
+}
+
+inline void op_ld_pitch_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.pitch = c.v_regs[op.x];
+}
+
+inline void op_scd(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.scroll_down(op.n);
+}
+
+inline void op_scu(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.scroll_up(op.n);
+}
+
+inline void op_scr(Chip8& c, const DecodedOp&, uint16_t&) {
+    c.scroll_right();
+}
+
+inline void op_scl(Chip8& c, const DecodedOp&, uint16_t&) {
+    c.scroll_left();
+}
+
+inline void op_exit(Chip8&, const DecodedOp&, uint16_t& pc) {
+    pc -= 2; // the machine has stopped; stay here
+}
+
+inline void op_low(Chip8& c, const DecodedOp&, uint16_t&) {
+    c.set_hires(false);
+}
+
+inline void op_high(Chip8& c, const DecodedOp&, uint16_t&) {
+    c.set_hires(true);
+}
+
+// 5XY2/5XY3: VX to VY, in whichever direction that is, at I; I stays
+inline void op_save_range(Chip8& c, const DecodedOp& op, uint16_t&) {
+    const int step = op.x <= op.y ? 1 : -1;
+    for (int r = op.x, k = 0;; r += step, ++k) {
+        c.write_memory(c.i_reg + k, c.v_regs[r]);
+        if (r == op.y) {
+            break;
+        }
+    }
+}
+
+inline void op_load_range(Chip8& c, const DecodedOp& op, uint16_t&) {
+    const int step = op.x <= op.y ? 1 : -1;
+    for (int r = op.x, k = 0;; r += step, ++k) {
+        c.v_regs[r] = c.memory[c.i_reg + k];
+        if (r == op.y) {
+            break;
+        }
+    }
+}
+
+// the 16-bit address is the instruction's second word
+inline void op_ld_i_long(Chip8& c, const DecodedOp&, uint16_t& pc) {
+    c.i_reg = (c.memory[pc] << 8) | c.memory[pc + 1];
+    pc += 2;
+}
+
+inline void op_plane(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.planes = op.x & ((1 << NUM_PLANES) - 1);
+}
+
+inline void op_ld_hf_vx(Chip8& c, const DecodedOp& op, uint16_t&) {
+    c.i_reg = BIG_FONTSET_START_ADDRESS + (c.v_regs[op.x] & 0xF) * 10;
+}
+
+inline void op_save_flags(Chip8& c, const DecodedOp& op, uint16_t&) {
+    std::copy_n(c.v_regs.begin(), op.x + 1, c.rpl_flags.begin());
+}
+
+inline void op_load_flags(Chip8& c, const DecodedOp& op, uint16_t&) {
+    std::copy_n(c.rpl_flags.begin(), op.x + 1, c.v_regs.begin());
+}
+
+// Indexed by OpKind. OP_UNDECODED never reaches a handler.
+template <Quirks Q>
+constexpr OpHandler handlers[OP_COUNT] = {
+    op_unknown, op_unknown, op_sys, op_cls, op_ret, op_jp, op_call,
+    op_se_vx_nn<Q>, op_sne_vx_nn<Q>, op_se_vx_vy<Q>, op_ld_vx_nn, op_add_vx_nn,
+    op_ld_vx_vy, op_or_vx_vy<Q>, op_and_vx_vy<Q>, op_xor_vx_vy<Q>, op_add_vx_vy, op_sub, op_shr<Q>, op_subn, op_shl<Q>,
+    op_sne_vx_vy<Q>, op_ld_i, op_jp_v0<Q>, op_rnd, op_drw<Q>, op_skp<Q>, op_sknp<Q>,
+    op_ld_vx_dt, op_ld_vx_k, op_ld_dt_vx, op_ld_st_vx, op_add_i_vx<Q>, op_ld_f_vx,
+    op_ld_b_vx, op_ld_mem_vx<Q>, op_ld_vx_mem<Q>, op_audio, op_ld_pitch_vx,
+    op_scd, op_scu, op_scr, op_scl, op_exit, op_low, op_high,
+    op_save_range, op_load_range, op_ld_i_long, op_plane, op_ld_hf_vx, op_save_flags, op_load_flags,
+    // superinstructions, one instruction at a time
+    op_ld_i, op_ld_vx_nn, op_ld_vx_dt, op_add_vx_nn,
+};
+
+// indexed by QuirkProfile
+constexpr const OpHandler* handler_tables[QUIRKS_COUNT] = {
+    handlers<QUIRK_PROFILES[QUIRKS_MODERN]>, handlers<QUIRK_PROFILES[QUIRKS_VIP]>,
+    handlers<QUIRK_PROFILES[QUIRKS_CHIP48]>, handlers<QUIRK_PROFILES[QUIRKS_SCHIP]>,
+    handlers<QUIRK_PROFILES[QUIRKS_XOCHIP]>,
+};
+
+template <Quirks Q>
+void draw_as(Chip8& c, uint8_t x, uint8_t y, uint8_t height) {
+    draw<Q.clip_sprites, Q.zero_height>(c, x, y, height);
+}
+
+// indexed by QuirkProfile
+using DrawFunction = void (*)(Chip8&, uint8_t, uint8_t, uint8_t);
+constexpr DrawFunction draw_functions[QUIRKS_COUNT] = {
+    draw_as<QUIRK_PROFILES[QUIRKS_MODERN]>, draw_as<QUIRK_PROFILES[QUIRKS_VIP]>,
+    draw_as<QUIRK_PROFILES[QUIRKS_CHIP48]>, draw_as<QUIRK_PROFILES[QUIRKS_SCHIP]>,
+    draw_as<QUIRK_PROFILES[QUIRKS_XOCHIP]>,
+};
+
+} // namespace
+
+void Chip8::draw_sprite(uint8_t x, uint8_t y, uint8_t height) {
+    draw_functions[quirks](*this, x, y, height);
+}
+
+// Whole rows move as blocks; only the sideways scrolls touch the bits, a
+// word (lores) or a word pair (hires) at a time.
+void Chip8::clear_screen() {
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (planes & (1 << p)) {
+            std::fill_n(screen.planes[p].begin(), screen.height(), Framebuffer::Row{});
+        }
+    }
+}
+
+void Chip8::scroll_down(uint8_t rows) {
+    const size_t height = screen.height();
+    const size_t by = std::min<size_t>(rows, height);
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (planes & (1 << p)) {
+            auto first = screen.planes[p].begin();
+            std::copy_backward(first, first + (height - by), first + height);
+            std::fill_n(first, by, Framebuffer::Row{});
+        }
+    }
+}
+
+void Chip8::scroll_up(uint8_t rows) {
+    const size_t height = screen.height();
+    const size_t by = std::min<size_t>(rows, height);
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (planes & (1 << p)) {
+            auto first = screen.planes[p].begin();
+            std::copy(first + by, first + height, first);
+            std::fill_n(first + (height - by), by, Framebuffer::Row{});
+        }
+    }
+}
+
+void Chip8::scroll_right() {
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (!(planes & (1 << p))) {
+            continue;
+        }
+        for (size_t y = 0; y < screen.height(); ++y) {
+            Framebuffer::Row& row = screen.planes[p][y];
+            if (screen.hires) {
+                row[1] = (row[1] >> 4) | (row[0] << 60);
+            }
+            row[0] >>= 4;
+        }
+    }
+}
+
+void Chip8::scroll_left() {
+    for (size_t p = 0; p < NUM_PLANES; ++p) {
+        if (!(planes & (1 << p))) {
+            continue;
+        }
+        for (size_t y = 0; y < screen.height(); ++y) {
+            Framebuffer::Row& row = screen.planes[p][y];
+            if (screen.hires) {
+                row[0] = (row[0] << 4) | (row[1] >> 60);
+                row[1] <<= 4;
+            } else {
+                row[0] <<= 4;
+            }
+        }
+    }
+}
+
+void Chip8::set_hires(bool on) {
+    screen.hires = on;
+    for (Framebuffer::Plane& plane : screen.planes) {
+        plane.fill({});
+    }
+}
+
+//  opcode executor
+void Chip8::run_opcode(uint16_t opcode) {
+    DecodedOp op = decode_opcode(opcode);
+    handler_tables[quirks][op.kind](*this, op, pc);
+}
+
+// Between chunks of this many instructions run() looks for an idle loop,
+// so a ROM that settles into one mid-slice wastes at most a chunk.
+constexpr int IDLE_CHECK_INTERVAL = 4096;
+
+int Chip8::run(int count) {
+    if (recorder) {
+        recorder->sync_keys(*this);
+    }
+    if (debugger) {
+        return interpret_debugged(count);
+    }
+    if (tracer) {
+        interpret_traced(count);
+        return count;
+    }
+    if (profiler) {
+        interpret_profiled(count);
+        return count;
+    }
+
+    idle = IDLE_NONE;
+    // skipped idle loops count as run: cycles moves on for them too
+    const int requested = count;
+    while (count > 0) {
+        if (idle_skipping && skip_idle(count)) {
+            break;
+        }
+        const int chunk = idle_skipping ? std::min(count, IDLE_CHECK_INTERVAL) : count;
+        if (aot) {
+            aot->run(*this, chunk);
+        } else if (jit) {
+            jit->run(*this, chunk);
+        } else {
+            interpret(chunk);
+        }
+        count -= chunk;
+    }
+    return requested;
+}
+
+// Timers and keys only change between run() calls, so within one call
+// each of these loops is a fixed point (or, for the timer poll, a fixed
+// three-instruction cycle) and the remaining instructions can be skipped by
+// bumping `cycles` and putting pc and Vx where they would have ended up.
+bool Chip8::skip_idle(int& count) {
+    const uint16_t mask = code_size() - 1;
+    const auto fetch = [this, mask](uint16_t address) {
+        return static_cast<uint16_t>((memory[address & mask] << 8) | memory[(address + 1) & mask]);
+    };
+    const uint16_t at = pc & mask;
+    const uint16_t opcode = fetch(at);
+
+    // 1NNN only reaches the first 4K; 00FD stays put the same way
+    if ((at < 0x1000 && opcode == (0x1000 | at)) || opcode == 0x00FD) {
+        idle = IDLE_SELF_JUMP;
+    } else if ((opcode & 0xF0FF) == 0xF00A && std::find(keypad.begin(), keypad.end(), true) == keypad.end()) {
+        idle = IDLE_KEY_WAIT;
+    }
+    if (idle != IDLE_NONE) {
+        cycles += count;
+        count = 0;
+        return true;
+    }
+
+    // loop head: FX07, then SE VX NN, then JP back to the FX07
+    for (uint16_t back = 0; back <= 4; back += 2) {
+        const uint16_t head = (at - back) & mask;
+        const uint16_t load = fetch(head);
+        const uint16_t skip = fetch(head + 2);
+        const uint8_t x = (load >> 8) & 0xF;
+        if (head >= 0x1000 || (load & 0xF0FF) != 0xF007 || (skip & 0xFF00) != (0x3000 | x << 8) ||
+            fetch(head + 4) != (0x1000 | head)) {
+            continue;
+        }
+        if (delay_timer == (skip & 0xFF)) {
+            return false; // leaves the loop this time round
+        }
+        // come round to the head the ordinary way first; entering in the
+        // middle with a stale Vx could still fall out of the loop
+        while (back && count > 0 && (pc & mask) != head) {
+            interpret(1);
+            --count;
+        }
+        if ((pc & mask) != head) {
+            return false;
+        }
+        if (count > 0) {
+            v_regs[x] = delay_timer;
+            pc = head + 2 * (count % 3);
+            cycles += count;
+            count = 0;
+        }
+        idle = IDLE_TIMER_POLL;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+// The PROFILED loop's bookkeeping before each dispatch. It decodes on the
+// spot so no counter ever sees OP_UNDECODED, and counts a pair only when the
+// second op follows the first in memory, since only those could be fused.
+inline void count_op(Profiler& profile, DecodedOp& op, const Chip8& c, uint16_t at, uint16_t mask) {
+    if (op.kind == OP_UNDECODED) {
+        op = decode_at(c, at, mask);
+    }
+    const OpKind kind = first_op(op.kind);
+    ++profile.op_counts[kind];
+    ++profile.pc_hits[at];
+    if (at == ((profile.last_at + 2) & mask)) {
+        ++profile.pair_counts[profile.last_kind][kind];
+    }
+    profile.last_at = at;
+    profile.last_kind = kind;
+}
+
+// Executes `count` instructions out of the decode cache. With GCC/Clang
+// each handler jumps straight to the next one through a computed goto
+// (threaded dispatch), so there is no central switch to mispredict.
+//
+// Slots are passed through fuse_ops() as they're decoded, and a
+// superinstruction accounts for every instruction it stands for, so
+// `count` stays exact. One that would run past the end of the batch runs as
+// its first instruction only.
+//
+// There is one copy of the loop per quirk profile, Q, with that profile's
+// handlers inlined. PROFILED builds a second copy of each that bumps the
+// profiler's per-class, per-address and per-pair counters on every
+// dispatch; the plain copy has no trace of it. The profiled copy decodes
+// without fusing and runs fused slots one instruction at a time, so every
+// instruction is counted.
+template <Quirks Q, bool PROFILED>
+void interpret_loop(Chip8& c, int count) {
+    if (count <= 0) {
+        return;
+    }
+    constexpr uint16_t CODE_MASK = code_size_for(Q) - 1;
+    if (c.decode_cache.size() != CODE_MASK + 1u) {
+        c.decode_cache.assign(CODE_MASK + 1u, DecodedOp{});
+    }
+
+    DecodedOp* cache = c.decode_cache.data();
+    DecodedOp* op = nullptr;
+    int remaining = count;
+    uint16_t next_pc = c.pc; // kept in a register, written back at the end
+    [[maybe_unused]] Profiler* profile = c.profiler;
+    const bool fusing = c.fusing;
+
+#if defined(__GNUC__)
+    static const void* const labels[OP_COUNT] = {
+        &&l_undecoded, &&l_unknown, &&l_sys, &&l_cls, &&l_ret, &&l_jp, &&l_call,
+        &&l_se_vx_nn, &&l_sne_vx_nn, &&l_se_vx_vy, &&l_ld_vx_nn, &&l_add_vx_nn,
+        &&l_ld_vx_vy, &&l_or_vx_vy, &&l_and_vx_vy, &&l_xor_vx_vy, &&l_add_vx_vy, &&l_sub, &&l_shr, &&l_subn, &&l_shl,
+        &&l_sne_vx_vy, &&l_ld_i, &&l_jp_v0, &&l_rnd, &&l_drw, &&l_skp, &&l_sknp,
+        &&l_ld_vx_dt, &&l_ld_vx_k, &&l_ld_dt_vx, &&l_ld_st_vx, &&l_add_i_vx, &&l_ld_f_vx,
+        &&l_ld_b_vx, &&l_ld_mem_vx, &&l_ld_vx_mem, &&l_audio, &&l_ld_pitch_vx,
+        &&l_scd, &&l_scu, &&l_scr, &&l_scl, &&l_exit, &&l_low, &&l_high,
+        &&l_save_range, &&l_load_range, &&l_ld_i_long, &&l_plane, &&l_ld_hf_vx, &&l_save_flags, &&l_load_flags,
+        &&l_ld_i_drw, &&l_ld_vx_vy_nn, &&l_wait_dt, &&l_add_se,
+    };
+
+#define DISPATCH()                                                   \
+    do {                                                             \
+        if (--remaining < 0) goto done;                              \
+        next_pc &= CODE_MASK;                                        \
+        op = &cache[next_pc];                                        \
+        if constexpr (PROFILED) {                                    \
+            count_op(*profile, *op, c, next_pc, CODE_MASK);          \
+        }                                                            \
+        next_pc += 2;                                                \
+        goto *labels[op->kind];                                      \
+    } while (0)
+#define HANDLER(name) l_##name: op_##name(c, *op, next_pc); DISPATCH();
+#define QUIRK_HANDLER(name) l_##name: op_##name<Q>(c, *op, next_pc); DISPATCH();
+
+    DISPATCH();
+
+l_undecoded:
+    *op = decode_at(c, next_pc - 2, CODE_MASK);
+    if (fusing) {
+        *op = fuse_ops(*op, (c.memory[next_pc & CODE_MASK] << 8) | c.memory[(next_pc + 1) & CODE_MASK],
+                       (c.memory[(next_pc + 2) & CODE_MASK] << 8) | c.memory[(next_pc + 3) & CODE_MASK]);
+    }
+    goto *labels[op->kind];
+
+    HANDLER(unknown)
+    HANDLER(sys)
+    HANDLER(cls)
+    HANDLER(ret)
+    HANDLER(jp)
+    HANDLER(call)
+    QUIRK_HANDLER(se_vx_nn)
+    QUIRK_HANDLER(sne_vx_nn)
+    QUIRK_HANDLER(se_vx_vy)
+    HANDLER(ld_vx_nn)
+    HANDLER(add_vx_nn)
+    HANDLER(ld_vx_vy)
+    QUIRK_HANDLER(or_vx_vy)
+    QUIRK_HANDLER(and_vx_vy)
+    QUIRK_HANDLER(xor_vx_vy)
+    HANDLER(add_vx_vy)
+    HANDLER(sub)
+    QUIRK_HANDLER(shr)
+    HANDLER(subn)
+    QUIRK_HANDLER(shl)
+    QUIRK_HANDLER(sne_vx_vy)
+    HANDLER(ld_i)
+    QUIRK_HANDLER(jp_v0)
+    HANDLER(rnd)
+    QUIRK_HANDLER(drw)
+    QUIRK_HANDLER(skp)
+    QUIRK_HANDLER(sknp)
+    HANDLER(ld_vx_dt)
+    HANDLER(ld_vx_k)
+    HANDLER(ld_dt_vx)
+    HANDLER(ld_st_vx)
+    QUIRK_HANDLER(add_i_vx)
+    HANDLER(ld_f_vx)
+    HANDLER(ld_b_vx)
+    QUIRK_HANDLER(ld_mem_vx)
+    QUIRK_HANDLER(ld_vx_mem)
+    HANDLER(audio)
+    HANDLER(ld_pitch_vx)
+    HANDLER(scd)
+    HANDLER(scu)
+    HANDLER(scr)
+    HANDLER(scl)
+    HANDLER(exit)
+    HANDLER(low)
+    HANDLER(high)
+    HANDLER(save_range)
+    HANDLER(load_range)
+    HANDLER(ld_i_long)
+    HANDLER(plane)
+    HANDLER(ld_hf_vx)
+    HANDLER(save_flags)
+    HANDLER(load_flags)
+
+    // `remaining` already excludes the first instruction; take off the rest
+l_ld_i_drw:
+    if (PROFILED || remaining < 1) goto l_ld_i;
+    --remaining;
+    c.i_reg = op->nnn;
+    next_pc += 2;
+    op_drw<Q>(c, *op, next_pc);
+    DISPATCH();
+
+l_ld_vx_vy_nn:
+    if (PROFILED || remaining < 1) goto l_ld_vx_nn;
+    --remaining;
+    c.v_regs[op->x] = op->nn;
+    c.v_regs[op->y] = op->n;
+    next_pc += 2;
+    DISPATCH();
+
+l_wait_dt:
+    if (PROFILED || remaining < 2) goto l_ld_vx_dt;
+    c.v_regs[op->x] = c.delay_timer;
+    if (c.v_regs[op->y] == op->n) {
+        --remaining; // skips the jump
+        next_pc += 4;
+    } else {
+        remaining -= 2;
+        next_pc = op->nnn;
+    }
+    DISPATCH();
+
+l_add_se:
+    if (PROFILED || remaining < 1) goto l_add_vx_nn;
+    --remaining;
+    c.v_regs[op->x] += op->nn;
+    next_pc += 2;
+    // a branch, like 3XNN's, not a select: pc must not wait on the add
+    if (c.v_regs[op->y] == op->n) {
+        next_pc += 2;
+    }
+    DISPATCH();
+
+#undef QUIRK_HANDLER
+#undef HANDLER
+#undef DISPATCH
+done:
+    c.pc = next_pc;
+#else
+    // no fusing here: fused slots left by another path run one at a time
+    while (remaining-- > 0) {
+        c.pc &= CODE_MASK;
+        op = &cache[c.pc];
+        if (op->kind == OP_UNDECODED) {
+            *op = decode_at(c, c.pc, CODE_MASK);
+        }
+        if constexpr (PROFILED) {
+            count_op(*profile, *op, c, c.pc, CODE_MASK);
+        }
+        c.pc += 2;
+        handlers<Q>[op->kind](c, *op, c.pc);
+    }
+#endif
+    c.cycles += count;
+}
+
+// indexed by QuirkProfile
+using InterpretLoop = void (*)(Chip8&, int);
+template <bool PROFILED>
+constexpr InterpretLoop interpret_loops[QUIRKS_COUNT] = {
+    interpret_loop<QUIRK_PROFILES[QUIRKS_MODERN], PROFILED>, interpret_loop<QUIRK_PROFILES[QUIRKS_VIP], PROFILED>,
+    interpret_loop<QUIRK_PROFILES[QUIRKS_CHIP48], PROFILED>, interpret_loop<QUIRK_PROFILES[QUIRKS_SCHIP], PROFILED>,
+    interpret_loop<QUIRK_PROFILES[QUIRKS_XOCHIP], PROFILED>,
+};
+
+} // namespace
+
+void Chip8::interpret(int count) {
+    interpret_loops<false>[quirks](*this, count);
+}
+
+void Chip8::interpret_profiled(int count) {
+    if (profiler->pc_hits.size() < code_size()) {
+        profiler->pc_hits.resize(code_size());
+    }
+    interpret_loops<true>[quirks](*this, count);
+}
+
+// Plain one-at-a-time loop used while a tracer is attached, so records carry
+// exact cycle numbers. The fast paths above never pay for tracing.
+void Chip8::interpret_traced(int count) {
+    const uint16_t mask = code_size() - 1;
+    if (decode_cache.size() != code_size()) {
+        decode_cache.assign(code_size(), DecodedOp{});
+    }
+    const bool trace_cpu = tracer->wants(TRACE_CPU, TRACE_LEVEL_DEBUG);
+    const OpHandler* const handlers = handler_tables[quirks];
+
+    for (int i = 0; i < count; ++i) {
+        pc &= mask;
+        const uint16_t at = pc;
+        const uint16_t opcode = (memory[at] << 8) | memory[(at + 1) & mask];
+        DecodedOp& op = decode_cache[at];
+        if (op.kind == OP_UNDECODED) {
+            op = decode_opcode(opcode);
+        }
+        // a fused slot from the fast path runs as its first instruction
+        const uint16_t touched = registers_touched(op, QUIRK_PROFILES[quirks]);
+        if (trace_cpu) {
+            tracer->emit({cycles, at, opcode, touched, TRACE_CPU, TRACE_LEVEL_DEBUG});
+        }
+        TraceCategory category;
+        TraceLevel level;
+        const bool event = trace_event(*this, op, at, category, level) && tracer->wants(category, level);
+        pc += 2;
+        handlers[op.kind](*this, op, pc);
+        if (event) {
+            tracer->emit({cycles, at, opcode, touched, category, level});
+        }
+        ++cycles;
+    }
+}
+
+// One instruction at a time with the debugger asked before and after each;
+// stops early when it pauses. Traces like interpret_traced() if a tracer is
+// attached too.
+int Chip8::interpret_debugged(int count) {
+    const uint16_t mask = code_size() - 1;
+    if (decode_cache.size() != code_size()) {
+        decode_cache.assign(code_size(), DecodedOp{});
+    }
+    const bool trace_cpu = tracer && tracer->wants(TRACE_CPU, TRACE_LEVEL_DEBUG);
+    const OpHandler* const handlers = handler_tables[quirks];
+
+    idle = IDLE_NONE;
+    for (int i = 0; i < count; ++i) {
+        pc &= mask;
+        const uint16_t at = pc;
+        const uint16_t opcode = (memory[at] << 8) | memory[(at + 1) & mask];
+        DecodedOp& op = decode_cache[at];
+        if (op.kind == OP_UNDECODED) {
+            op = decode_opcode(opcode);
+        }
+        if (!debugger->before(*this, op)) {
+            return i;
+        }
+        if (trace_cpu) {
+            tracer->emit({cycles, at, opcode, registers_touched(op, QUIRK_PROFILES[quirks]), TRACE_CPU, TRACE_LEVEL_DEBUG});
+        }
+        TraceCategory category;
+        TraceLevel level;
+        const bool event = tracer && trace_event(*this, op, at, category, level) && tracer->wants(category, level);
+        pc += 2;
+        handlers[op.kind](*this, op, pc);
+        if (event) {
+            tracer->emit({cycles, at, opcode, registers_touched(op, QUIRK_PROFILES[quirks]), category, level});
+        }
+        ++cycles;
+        debugger->after(*this);
+    }
+    return count;
+}
+
+void Chip8::write_memory(uint16_t address, uint8_t value) {
+    address &= MEM_SIZE - 1;
+    memory.write(address, value);
+    // an instruction starting here or one byte earlier now reads differently,
+    // and so does a superinstruction starting up to 5 bytes earlier; code
+    // never reads past the end of the cache, which wraps like pc does
+    if (address < decode_cache.size()) {
+        const uint16_t mask = decode_cache.size() - 1;
+        decode_cache[address].kind = OP_UNDECODED;
+        decode_cache[(address - 1) & mask].kind = OP_UNDECODED;
+        for (uint16_t back = 2; back <= 5; ++back) {
+            DecodedOp& op = decode_cache[(address - back) & mask];
+            if (op.kind >= OP_FIRST_FUSED) {
+                op.kind = OP_UNDECODED;
+            }
+        }
+    }
+    if (jit) {
+        jit->invalidate(address);
+    }
+    if (aot) {
+        aot->invalidate(address);
+    }
+}
+
+void Chip8::invalidate_decode_cache() {
+    decode_cache.clear();
+    if (jit && jit->address_space() != code_size()) {
+        // the quirk profile changed how far pc goes; start over at that size
+        jit.reset();
+        set_jit(true);
+    } else if (jit) {
+        jit->flush();
+    }
+    if (aot) {
+        aot->flush(*this);
+    }
+}
+
+void Chip8::set_aot(const AotProgram* program) {
+    if (program) {
+        aot = std::make_unique<Aot>(*program, *this);
+    } else {
+        aot.reset();
+    }
+}
+
+bool Chip8::set_jit(bool enabled) {
+    if (!enabled) {
+        jit.reset();
+        return true;
+    }
+    if (!jit && Jit::available()) {
+        jit = std::make_unique<Jit>(*this);
+        if (!jit->ready()) {
+            jit.reset();
+        }
+    }
+    return jit != nullptr;
+}
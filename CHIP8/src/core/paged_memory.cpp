@@ -0,0 +1,190 @@
+#include "chip8.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace {
+
+using Page = PagedMemory::Page;
+using LowPages = PagedMemory::PageTable<LOW_MEMORY_PAGES>;
+using HighPages = PagedMemory::HighPages;
+using PageImage = std::array<std::shared_ptr<Page>, MEMORY_PAGES>;
+
+const std::shared_ptr<Page>& zero_page() {
+    static const auto page = std::make_shared<Page>();
+    return page;
+}
+
+// what initialize_system() leaves in the first 4 KB: zeroes, and the fonts
+// below PROGRAM_START
+const LowPages& blank_low() {
+    static const LowPages table = [] {
+        std::array<uint8_t, PROGRAM_START> low{};
+        std::memcpy(low.data() + FONTSET_START_ADDRESS, fontset, FONTSET_SIZE);
+        std::memcpy(low.data() + BIG_FONTSET_START_ADDRESS, big_fontset, BIG_FONTSET_SIZE);
+        LowPages pages;
+        for (size_t page = 0; page < LOW_MEMORY_PAGES; ++page) {
+            pages.owners[page] = zero_page();
+            if (page < PROGRAM_START / MEMORY_PAGE_SIZE) {
+                pages.owners[page] = std::make_shared<Page>();
+                std::memcpy(pages.owners[page]->data(), low.data() + page * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+            }
+            pages.pages[page] = pages.owners[page]->data();
+        }
+        return pages;
+    }();
+    return table;
+}
+
+// everything above 4 KB, zero, for every machine that hasn't written there
+const std::shared_ptr<HighPages>& blank_high() {
+    static const auto table = [] {
+        auto pages = std::make_shared<HighPages>();
+        for (size_t page = 0; page < pages->owners.size(); ++page) {
+            pages->owners[page] = zero_page();
+            pages->pages[page] = zero_page()->data();
+        }
+        return pages;
+    }();
+    return table;
+}
+
+// Only the pages the ROM covers are set; `high` is the blank high table
+// with the ROM's pages in it, for ROMs that reach past 4 KB.
+struct RomImage {
+    PageImage pages;
+    std::shared_ptr<HighPages> high;
+};
+
+// ROM pages by ROM contents; kept for the life of the process, which loads
+// a handful of distinct ROMs at most.
+std::mutex rom_images_lock;
+std::map<std::string, RomImage> rom_images;
+
+const RomImage& rom_image(const uint8_t* bytes, size_t size) {
+    std::lock_guard<std::mutex> guard(rom_images_lock);
+    RomImage& image = rom_images[std::string(reinterpret_cast<const char*>(bytes), size)];
+    if (!image.pages[PROGRAM_START / MEMORY_PAGE_SIZE]) {
+        for (size_t offset = 0; offset < size; offset += MEMORY_PAGE_SIZE) {
+            auto page = std::make_shared<Page>();
+            std::memcpy(page->data(), bytes + offset, std::min(MEMORY_PAGE_SIZE, size - offset));
+            image.pages[(PROGRAM_START + offset) / MEMORY_PAGE_SIZE] = page;
+        }
+        if (PROGRAM_START + size > CLASSIC_MEM_SIZE) {
+            image.high = std::make_shared<HighPages>(*blank_high());
+            for (size_t page = LOW_MEMORY_PAGES; page < MEMORY_PAGES && image.pages[page]; ++page) {
+                image.high->owners[page - LOW_MEMORY_PAGES] = image.pages[page];
+                image.high->pages[page - LOW_MEMORY_PAGES] = image.pages[page]->data();
+            }
+        }
+    }
+    return image;
+}
+
+// copy the page first if anything else still holds it
+template <size_t N>
+void write_page(PagedMemory::PageTable<N>& table, size_t page, size_t offset, uint8_t value) {
+    if (table.owners[page].use_count() != 1) {
+        table.owners[page] = std::make_shared<Page>(*table.owners[page]);
+        table.pages[page] = table.owners[page]->data();
+    }
+    (*table.owners[page])[offset] = value;
+}
+
+} // namespace
+
+PagedMemory::PagedMemory() {
+    reset();
+}
+
+void PagedMemory::reset() {
+    low_ = blank_low();
+    high_ = blank_high();
+}
+
+// A page anything else still holds - the zero page, a font or ROM page,
+// another machine - is copied first, so the write only ever lands in one
+// this machine owns alone. Above 4 KB the same goes for the table itself.
+void PagedMemory::write(uint16_t address, uint8_t value) {
+    address &= MEM_SIZE - 1;
+    const size_t page = address / MEMORY_PAGE_SIZE;
+    if (page < LOW_MEMORY_PAGES) {
+        write_page(low_, page, address % MEMORY_PAGE_SIZE, value);
+        return;
+    }
+    write_page(own_high(), page - LOW_MEMORY_PAGES, address % MEMORY_PAGE_SIZE, value);
+}
+
+PagedMemory::HighPages& PagedMemory::own_high() {
+    if (high_.use_count() != 1) {
+        high_ = std::make_shared<HighPages>(*high_);
+    }
+    return *high_;
+}
+
+// Pages whose bytes wouldn't change stay shared.
+void PagedMemory::write(uint16_t address, const uint8_t* bytes, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if ((*this)[address + i] != bytes[i]) {
+            write(static_cast<uint16_t>(address + i), bytes[i]);
+        }
+    }
+}
+
+void PagedMemory::read(uint16_t address, uint8_t* out, size_t size) const {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = (*this)[address + i];
+    }
+}
+
+bool PagedMemory::matches(uint16_t address, const uint8_t* bytes, size_t size) const {
+    for (size_t i = 0; i < size; ++i) {
+        if ((*this)[address + i] != bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The ROM's last page is only mapped whole if what's already past the ROM
+// there is zero, as it is after initialize_system(); otherwise the ROM is
+// written into it like any other store. A machine that hasn't written
+// above 4 KB takes the ROM's high table as it is.
+void PagedMemory::load_program(const uint8_t* bytes, size_t size) {
+    const RomImage& image = rom_image(bytes, size);
+    const bool adopt_high = image.high && high_ == blank_high();
+    if (adopt_high) {
+        high_ = image.high;
+    }
+    for (size_t offset = 0; offset < size; offset += MEMORY_PAGE_SIZE) {
+        const size_t page = (PROGRAM_START + offset) / MEMORY_PAGE_SIZE;
+        const size_t length = std::min(MEMORY_PAGE_SIZE, size - offset);
+        if (page >= LOW_MEMORY_PAGES && adopt_high) {
+            continue;
+        }
+        const uint8_t* current = this->page(page);
+        const bool tail_clear = std::all_of(current + length, current + MEMORY_PAGE_SIZE,
+                                            [](uint8_t byte) { return byte == 0; });
+        if (!tail_clear) {
+            write(static_cast<uint16_t>(PROGRAM_START + offset), bytes + offset, length);
+        } else if (page < LOW_MEMORY_PAGES) {
+            low_.owners[page] = image.pages[page];
+            low_.pages[page] = low_.owners[page]->data();
+        } else {
+            HighPages& high = own_high();
+            high.owners[page - LOW_MEMORY_PAGES] = image.pages[page];
+            high.pages[page - LOW_MEMORY_PAGES] = image.pages[page]->data();
+        }
+    }
+}
+
+// a high table other machines share has no pages of this one's own in it
+size_t PagedMemory::private_pages() const {
+    const auto alone = [](const std::shared_ptr<Page>& page) { return page.use_count() == 1; };
+    size_t count = std::count_if(low_.owners.begin(), low_.owners.end(), alone);
+    if (high_.use_count() == 1) {
+        count += std::count_if(high_->owners.begin(), high_->owners.end(), alone);
+    }
+    return count;
+}
@@ -0,0 +1,158 @@
+#include "profiler.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+
+namespace {
+
+int64_t bucket_upper(size_t index, int sub_bits) {
+    const size_t sub_count = size_t{1} << sub_bits;
+    if (index < sub_count) {
+        return static_cast<int64_t>(index);
+    }
+    const int shift = static_cast<int>(index >> sub_bits) - 1;
+    const uint64_t sub = (index & (sub_count - 1)) | sub_count;
+    return static_cast<int64_t>(((sub + 1) << shift) - 1);
+}
+
+} // namespace
+
+void TimeHistogram::record(int64_t ns) {
+    const uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    size_t index = value;
+    if (value >= (uint64_t{1} << SUB_BITS)) {
+        const int shift = std::bit_width(value) - 1 - SUB_BITS;
+        index = (static_cast<size_t>(shift + 1) << SUB_BITS) | ((value >> shift) & ((1 << SUB_BITS) - 1));
+    }
+    ++buckets_[index];
+    ++count_;
+    max_ = std::max(max_, static_cast<int64_t>(value));
+}
+
+int64_t TimeHistogram::percentile(double p) const {
+    if (!count_) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * count_ + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(bucket_upper(i, SUB_BITS), max_);
+        }
+    }
+    return max_;
+}
+
+uint64_t Profiler::instructions() const {
+    return std::accumulate(op_counts.begin(), op_counts.end(), uint64_t{0});
+}
+
+std::vector<Hotspot> Profiler::hotspots(size_t count) const {
+    std::vector<Hotspot> all;
+    for (size_t address = 0; address < pc_hits.size(); ++address) {
+        if (pc_hits[address]) {
+            all.push_back({static_cast<uint16_t>(address), pc_hits[address]});
+        }
+    }
+    count = std::min(count, all.size());
+    std::partial_sort(all.begin(), all.begin() + count, all.end(),
+                      [](const Hotspot& a, const Hotspot& b) { return a.hits > b.hits; });
+    all.resize(count);
+    return all;
+}
+
+std::vector<OpPair> Profiler::top_pairs(size_t count) const {
+    std::vector<OpPair> all;
+    for (size_t first = 0; first < OP_COUNT; ++first) {
+        for (size_t second = 0; second < OP_COUNT; ++second) {
+            if (pair_counts[first][second]) {
+                all.push_back({static_cast<OpKind>(first), static_cast<OpKind>(second), pair_counts[first][second]});
+            }
+        }
+    }
+    count = std::min(count, all.size());
+    std::partial_sort(all.begin(), all.begin() + count, all.end(),
+                      [](const OpPair& a, const OpPair& b) { return a.count > b.count; });
+    all.resize(count);
+    return all;
+}
+
+void Profiler::summarize(ProfileSummary& summary, uint64_t cycles, int64_t now_ns) {
+    if (last_ns_ && now_ns > last_ns_) {
+        summary.ips = (cycles - last_cycles_) * 1e9 / (now_ns - last_ns_);
+    }
+    last_cycles_ = cycles;
+    last_ns_ = now_ns;
+
+    std::array<uint8_t, OP_COUNT> order;
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + 3, order.end(),
+                      [&](uint8_t a, uint8_t b) { return op_counts[a] > op_counts[b]; });
+    const uint64_t total = instructions();
+    for (int i = 0; i < 3; ++i) {
+        summary.top_ops[i] = static_cast<OpKind>(order[i]);
+        summary.top_op_share[i] = total ? static_cast<double>(op_counts[order[i]]) / total : 0.0;
+    }
+    const std::vector<Hotspot> top = hotspots(3);
+    for (size_t i = 0; i < 3; ++i) {
+        summary.hotspots[i] = i < top.size() ? top[i] : Hotspot{0, 0};
+    }
+    summary.emulate_p50 = emulate.percentile(50);
+    summary.emulate_p99 = emulate.percentile(99);
+}
+
+bool Profiler::write_report(const Chip8& chip8, const std::string& filepath) const {
+    std::FILE* file = std::fopen(filepath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    const uint64_t total = instructions();
+    std::fprintf(file, "CHIP-8 profile\n\ninstructions profiled  %llu\n\n",
+                 static_cast<unsigned long long>(total));
+
+    std::fprintf(file, "opcode class        count      share\n");
+    std::array<uint8_t, OP_COUNT> order;
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint8_t a, uint8_t b) { return op_counts[a] > op_counts[b]; });
+    for (uint8_t kind : order) {
+        if (op_counts[kind]) {
+            std::fprintf(file, "  %-8s %14llu  %6.2f%%\n", op_kind_pattern(static_cast<OpKind>(kind)),
+                         static_cast<unsigned long long>(op_counts[kind]), 100.0 * op_counts[kind] / total);
+        }
+    }
+
+    // disassembly is of memory as it is now; self-modified code may have
+    // held something else while it was being counted
+    std::fprintf(file, "\nhotspots            count      share  instruction\n");
+    for (const Hotspot& spot : hotspots(32)) {
+        const uint16_t opcode = (chip8.memory[spot.address] << 8) | chip8.memory[(spot.address + 1) & (MEM_SIZE - 1)];
+        std::fprintf(file, "  0x%03X    %14llu  %6.2f%%  %04X  %s\n", spot.address,
+                     static_cast<unsigned long long>(spot.hits), 100.0 * spot.hits / total, opcode,
+                     disassemble(opcode).c_str());
+    }
+
+    // * = already fused into a superinstruction outside of profiling
+    std::fprintf(file, "\nadjacent pairs      count      share\n");
+    for (const OpPair& pair : top_pairs(16)) {
+        std::fprintf(file, "  %s %s%s %13llu  %6.2f%%\n", op_kind_pattern(pair.first), op_kind_pattern(pair.second),
+                     fuses(pair.first, pair.second) ? "*" : " ", static_cast<unsigned long long>(pair.count),
+                     100.0 * pair.count / total);
+    }
+
+    std::fprintf(file, "\nframe time (us)      frames      p50      p90      p99      max\n");
+    const std::pair<const char*, const TimeHistogram*> series[] = {{"emulate", &emulate}, {"present", &present}};
+    for (const auto& [name, histogram] : series) {
+        if (histogram->count()) {
+            std::fprintf(file, "  %-8s %14llu %8.2f %8.2f %8.2f %8.2f\n", name,
+                         static_cast<unsigned long long>(histogram->count()),
+                         histogram->percentile(50) / 1e3, histogram->percentile(90) / 1e3,
+                         histogram->percentile(99) / 1e3, histogram->max() / 1e3);
+        }
+    }
+    std::fclose(file);
+    return true;
+}
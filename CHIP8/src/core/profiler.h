@@ -0,0 +1,78 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include "chip8.h"
+#include <string>
+#include <vector>
+
+// Log-linear histogram of durations: 32 buckets per power of two, so any
+// percentile is within ~3% using a fixed 8 KB, however long the run.
+class TimeHistogram {
+public:
+    void record(int64_t ns);
+    // upper edge of the bucket holding the p-th percentile (0..100)
+    int64_t percentile(double p) const;
+    uint64_t count() const { return count_; }
+    int64_t max() const { return max_; }
+
+private:
+    static constexpr int SUB_BITS = 5;
+    std::array<uint32_t, 64 << SUB_BITS> buckets_{};
+    uint64_t count_ = 0;
+    int64_t max_ = 0;
+};
+
+struct Hotspot {
+    uint16_t address;
+    uint64_t hits;
+};
+
+// two ops executed back to back from adjacent addresses
+struct OpPair {
+    OpKind first;
+    OpKind second;
+    uint64_t count;
+};
+
+// What the HUD shows, refreshed a few times a second by whoever owns the
+// machine and handed across threads by value.
+struct ProfileSummary {
+    double ips = 0;              // instructions per second since last summary
+    OpKind top_ops[3] = {};
+    double top_op_share[3] = {}; // fraction of all instructions
+    Hotspot hotspots[3] = {};
+    int64_t emulate_p50 = 0;
+    int64_t emulate_p99 = 0;
+};
+
+// Counters the interpreter fills while chip8.profiler points here. The
+// machine is interpreted (never recompiled) while attached, and the hot
+// loop pays three increments per instruction. Frame timings are recorded by
+// the frontend: `emulate` on the thread running the machine, `present` on
+// the one drawing it.
+class Profiler {
+public:
+    std::array<uint64_t, OP_COUNT> op_counts{};
+    // by address, as far as the machine's code_size(); sized on first use
+    std::vector<uint64_t> pc_hits;
+    // [first][second], only for ops that fall through to the next address;
+    // what to pick superinstructions by
+    std::array<std::array<uint64_t, OP_COUNT>, OP_COUNT> pair_counts{};
+    // the previous dispatch, so pairs span run() calls
+    uint16_t last_at = 0;
+    OpKind last_kind = OP_UNDECODED;
+    TimeHistogram emulate;
+    TimeHistogram present;
+
+    uint64_t instructions() const;
+    std::vector<Hotspot> hotspots(size_t count) const;
+    std::vector<OpPair> top_pairs(size_t count) const;
+    void summarize(ProfileSummary& summary, uint64_t cycles, int64_t now_ns);
+
+    bool write_report(const Chip8& chip8, const std::string& filepath) const;
+
+private:
+    uint64_t last_cycles_ = 0;
+    int64_t last_ns_ = 0;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,23 @@
+#include "quirks.h"
+#include <iostream>
+
+namespace {
+
+const char* const QUIRK_NAMES[QUIRKS_COUNT] = {"modern", "vip", "chip48", "schip", "xochip"};
+
+} // namespace
+
+const char* quirks_name(QuirkProfile profile) {
+    return profile < QUIRKS_COUNT ? QUIRK_NAMES[profile] : "?";
+}
+
+bool parse_quirks(const std::string& name, QuirkProfile& profile) {
+    for (int p = 0; p < QUIRKS_COUNT; ++p) {
+        if (name == QUIRK_NAMES[p]) {
+            profile = static_cast<QuirkProfile>(p);
+            return true;
+        }
+    }
+    std::cerr << "Unknown quirk profile > " << name << std::endl;
+    return false;
+}
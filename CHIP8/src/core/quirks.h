@@ -0,0 +1,60 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+#include <cstdint>
+#include <string>
+
+// Where the CHIP-8 interpreters ROMs were written for disagree. A Quirks
+// value is a compile-time policy: the interpreter is built once per profile
+// (see interpret_loop() in opcodes.cpp) and the recompilers pick the
+// variant when they translate, so nothing here is tested per instruction.
+// The VIP's wait for the display interrupt before DXYN isn't modelled.
+
+// what FX55/FX65 leave in I
+enum IndexAfterStore : uint8_t {
+    INDEX_PAST_LAST,    // I + X + 1
+    INDEX_AT_LAST,      // I + X, CHIP-48's off-by-one
+    INDEX_UNCHANGED
+};
+
+// what DXY0 draws
+enum ZeroHeightSprite : uint8_t {
+    SPRITE0_16X16,      // SUPER-CHIP's big sprite, two bytes a row
+    SPRITE0_8X16,       // CHIP-48's: sixteen one-byte rows
+    SPRITE0_NONE        // the VIP's: nothing, and VF = 0
+};
+
+struct Quirks {
+    bool logic_resets_vf;               // 8XY1/8XY2/8XY3 set VF to 0
+    bool shift_vx;                      // 8XY6/8XYE shift VX, not VY into VX
+    IndexAfterStore index_after_store;
+    bool clip_sprites;                  // DXYN clips at the edges rather than wrapping
+    bool jump_vx;                       // BXNN jumps to XNN + VX, not NNN + V0
+    bool index_overflow_vf;             // FX1E sets VF when I passes 0xFFF
+    bool long_skips;                    // skips step over F000 NNNN as one 4-byte instruction
+    bool long_code;                     // pc runs on past 0xFFF rather than wrapping to 0
+    ZeroHeightSprite zero_height;
+};
+
+enum QuirkProfile : uint8_t {
+    QUIRKS_MODERN,      // Octo's, plus VF from FX1E (Spacefight 2091! needs it); the default
+    QUIRKS_VIP,         // the original COSMAC VIP interpreter
+    QUIRKS_CHIP48,      // CHIP-48 on the HP-48
+    QUIRKS_SCHIP,       // SUPER-CHIP 1.1
+    QUIRKS_XOCHIP,      // Octo's XO-CHIP
+    QUIRKS_COUNT
+};
+
+constexpr Quirks QUIRK_PROFILES[QUIRKS_COUNT] = {
+    {false, false, INDEX_PAST_LAST, false, false, true, false, false, SPRITE0_16X16},
+    {true, false, INDEX_PAST_LAST, true, false, false, false, false, SPRITE0_NONE},
+    {false, true, INDEX_AT_LAST, true, true, false, false, false, SPRITE0_8X16},
+    {false, true, INDEX_UNCHANGED, true, true, false, false, false, SPRITE0_16X16},
+    {false, false, INDEX_PAST_LAST, false, false, false, true, true, SPRITE0_16X16},
+};
+
+// "modern", "vip", "chip48", "schip", "xochip"
+const char* quirks_name(QuirkProfile profile);
+// error on stderr and false for anything else
+bool parse_quirks(const std::string& name, QuirkProfile& profile);
+
+#endif // QUIRKS_H
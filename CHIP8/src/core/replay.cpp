@@ -0,0 +1,223 @@
+#include "replay.h"
+#include "savestate.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr uint8_t EVENT_TICK = 0x00;
+constexpr uint8_t EVENT_KEY = 0x20;
+constexpr uint8_t EVENT_PRESSED = 0x10;
+
+uint16_t key_mask(const Chip8& chip8) {
+    uint16_t mask = 0;
+    for (size_t key = 0; key < NUM_KEYS; ++key) {
+        mask |= chip8.keypad[key] << key;
+    }
+    return mask;
+}
+
+void put_le(std::ofstream& file, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        file.put(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+bool get_le(std::ifstream& file, uint64_t& value, int bytes) {
+    value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        const int byte = file.get();
+        if (byte == EOF) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte) << (8 * i);
+    }
+    return true;
+}
+
+void run_to(Chip8& chip8, uint64_t cycle) {
+    while (chip8.cycles < cycle) {
+        chip8.run(static_cast<int>(std::min<uint64_t>(cycle - chip8.cycles, INT_MAX)));
+    }
+}
+
+} // namespace
+
+// Memory past the classic 4 KB only counts if something is there, so a
+// CHIP-8 ROM hashes the same as before memory grew to 64 KB.
+uint64_t hash_rom(const Chip8& chip8) {
+    size_t end = CLASSIC_MEM_SIZE;
+    for (size_t address = CLASSIC_MEM_SIZE; address < MEM_SIZE; ++address) {
+        if (chip8.memory[address]) {
+            end = MEM_SIZE;
+            break;
+        }
+    }
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t address = PROGRAM_START; address < end; ++address) {
+        hash = (hash ^ chip8.memory[address]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// a loaded ROM is followed by zeroes up to the end of memory
+uint64_t hash_rom_image(const uint8_t* bytes, size_t size) {
+    size_t end = CLASSIC_MEM_SIZE - PROGRAM_START;
+    for (size_t i = end; i < size; ++i) {
+        if (bytes[i]) {
+            end = MEM_SIZE - PROGRAM_START;
+            break;
+        }
+    }
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < end; ++i) {
+        hash = (hash ^ (i < size ? bytes[i] : 0)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void Recorder::begin(const Chip8& chip8) {
+    rom_hash_ = hash_rom(chip8);
+    seed_ = chip8.rng_seed;
+    quirks_ = chip8.quirks;
+    last_cycle_ = chip8.cycles;
+    keys_ = key_mask(chip8);
+    events_.clear();
+}
+
+void Recorder::put_event(const Chip8& chip8, uint8_t what) {
+    uint64_t value = (chip8.cycles - last_cycle_) << 6 | what;
+    last_cycle_ = chip8.cycles;
+    while (value >= 0x80) {
+        events_.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    events_.push_back(static_cast<uint8_t>(value));
+}
+
+void Recorder::sync_keys(const Chip8& chip8) {
+    const uint16_t keys = key_mask(chip8);
+    uint16_t changed = keys ^ keys_;
+    while (changed) {
+        const int key = std::countr_zero(changed);
+        changed &= changed - 1;
+        put_event(chip8, EVENT_KEY | ((keys >> key) & 1 ? EVENT_PRESSED : 0) | key);
+    }
+    keys_ = keys;
+}
+
+void Recorder::timer_tick(const Chip8& chip8) {
+    sync_keys(chip8);
+    put_event(chip8, EVENT_TICK);
+}
+
+bool Recorder::finish(const Chip8& chip8, const std::string& filepath) {
+    // keys set by a last poll that no instruction ran after
+    sync_keys(chip8);
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    file.write(REPLAY_MAGIC, 4);
+    put_le(file, REPLAY_VERSION, 4);
+    put_le(file, rom_hash_, 8);
+    put_le(file, seed_, 8);
+    put_le(file, quirks_, 1);
+    put_le(file, chip8.cycles, 8);
+    put_le(file, hash_state(chip8), 8);
+    put_le(file, events_.size(), 4);
+    file.write(reinterpret_cast<const char*>(events_.data()), events_.size());
+    if (!file) {
+        std::cerr << "Can't write that file > " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_replay(const std::string& filepath, Replay& replay) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint64_t version = 0;
+    uint64_t size = 0;
+    if (!file.read(magic, 4) || !std::equal(magic, magic + 4, REPLAY_MAGIC) || !get_le(file, version, 4)) {
+        std::cerr << "Not a CHIP-8 replay > " << filepath << std::endl;
+        return false;
+    }
+    if (version < REPLAY_VERSION) {
+        std::cerr << "Replay version " << version << " predates the current state hash, record it again > "
+                  << filepath << std::endl;
+        return false;
+    }
+    if (version > REPLAY_VERSION) {
+        std::cerr << "Unsupported replay version " << version << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint64_t quirks = QUIRKS_MODERN;
+    if (!get_le(file, replay.rom_hash, 8) || !get_le(file, replay.seed, 8)
+        || !get_le(file, quirks, 1) || !get_le(file, replay.final_cycle, 8) || !get_le(file, replay.final_hash, 8)
+        || !get_le(file, size, 4)) {
+        std::cerr << "Replay is truncated > " << filepath << std::endl;
+        return false;
+    }
+    if (quirks >= QUIRKS_COUNT) {
+        std::cerr << "Replay uses an unknown quirk profile > " << filepath << std::endl;
+        return false;
+    }
+    replay.quirks = static_cast<QuirkProfile>(quirks);
+    bytes.resize(size);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), size)) {
+        std::cerr << "Replay is truncated > " << filepath << std::endl;
+        return false;
+    }
+
+    replay.events.clear();
+    uint64_t cycle = 0;
+    for (size_t i = 0; i < bytes.size();) {
+        uint64_t value = 0;
+        int shift = 0;
+        while (i < bytes.size() && bytes[i] & 0x80) {
+            value |= static_cast<uint64_t>(bytes[i++] & 0x7F) << shift;
+            shift += 7;
+        }
+        if (i == bytes.size()) {
+            std::cerr << "Replay is truncated > " << filepath << std::endl;
+            return false;
+        }
+        value |= static_cast<uint64_t>(bytes[i++]) << shift;
+        cycle += value >> 6;
+        replay.events.push_back({cycle, static_cast<uint8_t>(value & 0x3F)});
+    }
+    return true;
+}
+
+bool play_replay(Chip8& chip8, const Replay& replay) {
+    if (hash_rom(chip8) != replay.rom_hash) {
+        std::cerr << "Replay was recorded with a different ROM" << std::endl;
+        return false;
+    }
+    chip8.seed_random(replay.seed);
+    if (chip8.quirks != replay.quirks) {
+        chip8.quirks = replay.quirks;
+        chip8.set_aot(nullptr); // compiled for the profile it had
+        chip8.invalidate_decode_cache();
+    }
+    for (const ReplayEvent& event : replay.events) {
+        run_to(chip8, event.cycle);
+        if (event.what & EVENT_KEY) {
+            chip8.keypad[event.what & 0xF] = event.what & EVENT_PRESSED;
+        } else {
+            chip8.update_timers();
+        }
+    }
+    run_to(chip8, replay.final_cycle);
+    return hash_state(chip8) == replay.final_hash;
+}
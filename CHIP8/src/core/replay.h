@@ -0,0 +1,80 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+#include "chip8.h"
+#include <string>
+#include <vector>
+
+// Deterministic record/replay.
+//
+// With CXNN seeded per machine, the only things that reach a machine from
+// outside are key changes and the 60 Hz timer ticks, and both are logged
+// against the instruction count they happened at. Replaying the log from
+// the same ROM and seed reproduces the run exactly, whatever host speed,
+// scheduler or frontend produced it.
+//
+// Replay file: "C8RP", u32 version, u64 ROM hash, u64 seed, u8 quirk
+// profile, u64 final cycle, u64 final state hash, u32 event bytes, then
+// the events. Each event is one LEB128 varint of (cycles since previous
+// event << 6 | what), where what is 0 for a timer tick or
+// 0x20 | pressed << 4 | key.
+//
+// The version goes up whenever hash_state() changes, since an older
+// file's final hash can then never match; those are refused rather than
+// reported as mismatches. Version 3 hashes the audio state too; version 4
+// hashes the sparse save state image, and DXY0 and pc past 0xFFF follow
+// the quirk profile.
+constexpr char REPLAY_MAGIC[4] = {'C', '8', 'R', 'P'};
+constexpr uint32_t REPLAY_VERSION = 4;
+
+// FNV-1a over everything from PROGRAM_START up, right after loading
+uint64_t hash_rom(const Chip8& chip8);
+// the same for a ROM file's bytes, without loading them
+uint64_t hash_rom_image(const uint8_t* bytes, size_t size);
+
+// Attach through chip8.recorder after initialize_system(), seeding and
+// loading the ROM. Rewinding or loading a state while attached would cut
+// the log loose from the machine, so frontends turn those off.
+class Recorder {
+public:
+    void begin(const Chip8& chip8);
+    // from Chip8::run(): logs keys that changed since the last call
+    void sync_keys(const Chip8& chip8);
+    // from Chip8::update_timers()
+    void timer_tick(const Chip8& chip8);
+    bool finish(const Chip8& chip8, const std::string& filepath);
+
+    size_t event_bytes() const { return events_.size(); }
+
+private:
+    void put_event(const Chip8& chip8, uint8_t what);
+
+    uint64_t rom_hash_ = 0;
+    uint64_t seed_ = 0;
+    QuirkProfile quirks_ = QUIRKS_MODERN;
+    uint64_t last_cycle_ = 0;
+    uint16_t keys_ = 0;
+    std::vector<uint8_t> events_;
+};
+
+struct ReplayEvent {
+    uint64_t cycle;
+    uint8_t what;
+};
+
+struct Replay {
+    uint64_t rom_hash = 0;
+    uint64_t seed = 0;
+    QuirkProfile quirks = QUIRKS_MODERN;
+    uint64_t final_cycle = 0;
+    uint64_t final_hash = 0;
+    std::vector<ReplayEvent> events;
+};
+
+bool load_replay(const std::string& filepath, Replay& replay);
+
+// Plays the log into a freshly initialized machine with the ROM loaded, at
+// full speed and with the recorded quirk profile, and compares the final
+// state hash; false on a wrong ROM or any mismatch.
+bool play_replay(Chip8& chip8, const Replay& replay);
+
+#endif // REPLAY_H
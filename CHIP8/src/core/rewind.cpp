@@ -0,0 +1,192 @@
+#include "rewind.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Delta encoding: the older image's size, then repeated (skip, literal
+// count, literal bytes) groups, all counts as LEB128 varints. Images differ
+// in size with the pages they hold, so the shorter one counts as padded
+// with zeroes. Skipped bytes are equal in both images; literal bytes are
+// newer ^ older. Anything after the last group is equal.
+
+void put_varint(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t get_varint(const uint8_t*& in) {
+    size_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= static_cast<size_t>(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return value | static_cast<size_t>(*in++) << shift;
+}
+
+uint64_t load64(const uint8_t* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// Fewer equal bytes than this in the middle of a changed stretch are
+// cheaper to carry as literals than to end the group for.
+constexpr size_t MIN_SKIP = 4;
+
+// One span per this many bytes of delta ring: about what a frame's delta
+// takes, so the two rings fill at much the same rate.
+constexpr size_t BYTES_PER_SPAN = 32;
+
+void apply_delta(StateImage& image, const uint8_t* delta, size_t size) {
+    const uint8_t* in = delta;
+    const uint8_t* end = delta + size;
+    const size_t older_size = get_varint(in);
+    image.resize(std::max(image.size(), older_size));
+    size_t pos = 0;
+    while (in < end) {
+        pos += get_varint(in);
+        size_t count = get_varint(in);
+        while (count--) {
+            image[pos++] ^= *in++;
+        }
+    }
+    image.resize(older_size);
+}
+
+} // namespace
+
+RewindBuffer::RewindBuffer(size_t budget_bytes, uint32_t interval_frames)
+    : interval_(interval_frames ? interval_frames : 1) {
+    spans_.resize(std::max<size_t>(budget_bytes / (BYTES_PER_SPAN + sizeof(Span)), 1));
+    ring_.resize(budget_bytes - std::min(budget_bytes, spans_.size() * sizeof(Span)));
+}
+
+void RewindBuffer::on_frame(const Chip8& chip8) {
+    if (++frames_ >= interval_) {
+        frames_ = 0;
+        push(chip8);
+    }
+}
+
+void RewindBuffer::push(const Chip8& chip8) {
+    capture_state(chip8, current_);
+    if (has_head_) {
+        encode_delta(current_, head_);
+        store(scratch_);
+    }
+    std::swap(head_, current_);
+    has_head_ = true;
+}
+
+bool RewindBuffer::rewind(Chip8& chip8) {
+    if (span_count_ == 0) {
+        return false;
+    }
+    const Span newest = spans_[(first_span_ + --span_count_) % spans_.size()];
+    apply_delta(head_, ring_.data() + newest.offset, newest.size);
+    write_ = newest.offset;
+    delta_bytes_ -= newest.size;
+    restore_state(chip8, head_);
+    frames_ = 0;
+    return true;
+}
+
+void RewindBuffer::clear() {
+    span_count_ = 0;
+    write_ = 0;
+    delta_bytes_ = 0;
+    has_head_ = false;
+    frames_ = 0;
+}
+
+void RewindBuffer::encode_delta(const StateImage& newer, const StateImage& older) {
+    scratch_.clear();
+    put_varint(scratch_, older.size());
+    const uint8_t* a = newer.data();
+    const uint8_t* b = older.data();
+    const size_t size = std::max(newer.size(), older.size());
+    // sizes only differ on the frame a page turns non-zero or back
+    if (newer.size() != older.size()) {
+        padded_ = newer.size() < older.size() ? newer : older;
+        padded_.resize(size);
+        (newer.size() < older.size() ? a : b) = padded_.data();
+    }
+    size_t i = 0;
+    while (i < size) {
+        const size_t skip_start = i;
+        while (i + 8 <= size && load64(a + i) == load64(b + i)) {
+            i += 8;
+        }
+        while (i < size && a[i] == b[i]) {
+            ++i;
+        }
+        if (i == size) {
+            break;
+        }
+
+        const size_t literal_start = i;
+        while (i < size) {
+            if (a[i] != b[i]) {
+                ++i;
+                continue;
+            }
+            size_t same = i;
+            while (same < size && a[same] == b[same] && same - i < MIN_SKIP) {
+                ++same;
+            }
+            if (same - i >= MIN_SKIP || same == size) {
+                break;
+            }
+            i = same;
+        }
+
+        put_varint(scratch_, literal_start - skip_start);
+        put_varint(scratch_, i - literal_start);
+        for (size_t k = literal_start; k < i; ++k) {
+            scratch_.push_back(a[k] ^ b[k]);
+        }
+    }
+}
+
+void RewindBuffer::drop_oldest() {
+    delta_bytes_ -= oldest().size;
+    first_span_ = (first_span_ + 1) % spans_.size();
+    --span_count_;
+}
+
+// Deltas are laid end to end; the live ones always form one contiguous
+// (possibly wrapped) stretch from the oldest up to write_.
+void RewindBuffer::store(const std::vector<uint8_t>& delta) {
+    // an empty delta still takes up a byte, so it ages out of the ring
+    const size_t size = std::max<size_t>(delta.size(), 1);
+    if (size > ring_.size()) {
+        // budget too small for even one delta: only the head survives
+        span_count_ = 0;
+        write_ = 0;
+        delta_bytes_ = 0;
+        return;
+    }
+    if (write_ + size > ring_.size()) {
+        // leave the tail unused and wrap; whatever was there is the oldest
+        while (span_count_ > 0 && oldest().offset >= write_) {
+            drop_oldest();
+        }
+        write_ = 0;
+    }
+    while (span_count_ > 0 && oldest().offset >= write_ && oldest().offset < write_ + size) {
+        drop_oldest();
+    }
+    if (span_count_ == spans_.size()) {
+        drop_oldest();
+    }
+    std::memcpy(ring_.data() + write_, delta.data(), delta.size());
+    spans_[(first_span_ + span_count_++) % spans_.size()] = {static_cast<uint32_t>(write_),
+                                                              static_cast<uint32_t>(delta.size())};
+    write_ += size;
+    delta_bytes_ += delta.size();
+}
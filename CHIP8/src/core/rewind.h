@@ -0,0 +1,64 @@
+#ifndef REWIND_H
+#define REWIND_H
+#include "savestate.h"
+#include <vector>
+
+// Recent history for stepping a machine backwards.
+//
+// Only the newest snapshot is kept whole. Every older one is stored as the
+// XOR of itself with its successor, run-length encoded: between two frames
+// almost all of memory and the screen is unchanged, so a delta is usually a
+// few dozen bytes instead of a whole image. Rewinding XORs the newest delta
+// back into the head and drops it.
+//
+// Deltas are packed into one preallocated byte ring sized from the budget,
+// with their offsets in a second, fixed-capacity ring; when either is full
+// the oldest deltas are overwritten. The head and scratch images come on
+// top of the budget and only reallocate when the machine's state grows.
+class RewindBuffer {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 4 << 20;
+
+    explicit RewindBuffer(size_t budget_bytes = DEFAULT_BUDGET, uint32_t interval_frames = 1);
+
+    // call once per emulated frame; takes a snapshot every interval_frames
+    void on_frame(const Chip8& chip8);
+    void push(const Chip8& chip8);
+    // go back one snapshot; false (machine untouched) once history runs out
+    bool rewind(Chip8& chip8);
+    void clear();
+
+    size_t snapshots() const { return has_head_ ? span_count_ + 1 : 0; }
+    // head and scratch images, span ring and stored deltas
+    size_t bytes_used() const {
+        return head_.capacity() + current_.capacity() + padded_.capacity() + scratch_.capacity()
+               + spans_.size() * sizeof(Span) + delta_bytes_;
+    }
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    void encode_delta(const StateImage& newer, const StateImage& older);
+    void store(const std::vector<uint8_t>& delta);
+    const Span& oldest() const { return spans_[first_span_]; }
+    void drop_oldest();
+
+    std::vector<uint8_t> ring_;
+    std::vector<Span> spans_;   // ring of the live deltas, oldest at first_span_
+    size_t first_span_ = 0;
+    size_t span_count_ = 0;
+    size_t write_ = 0;
+    size_t delta_bytes_ = 0;
+    StateImage head_;
+    StateImage current_;
+    StateImage padded_;     // the shorter image of a pair, zero-padded
+    bool has_head_ = false;
+    std::vector<uint8_t> scratch_;
+    uint32_t interval_;
+    uint32_t frames_ = 0;
+};
+
+#endif // REWIND_H
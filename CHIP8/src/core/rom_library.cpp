@@ -0,0 +1,326 @@
+#include "rom_library.h"
+#include "chip8.h"
+#include "replay.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CHIP8_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedRom::~MappedRom() {
+    close();
+}
+
+void MappedRom::close() {
+#ifdef CHIP8_HAVE_MMAP
+    if (mapped_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+}
+
+bool MappedRom::open(const std::string& filepath) {
+    close();
+#ifdef CHIP8_HAVE_MMAP
+    const int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        std::cerr << "Can't read that file > " << filepath << std::endl;
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            std::cerr << "Can't read that file > " << filepath << std::endl;
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(mapping);
+        mapped_ = true;
+    }
+    ::close(fd); // the mapping stays valid
+    return true;
+#else
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    buffer_.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+        std::cerr << "Can't read that file > " << filepath << std::endl;
+        buffer_.clear();
+        return false;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+#endif
+}
+
+namespace {
+
+const char* const PLATFORM_NAMES[PLATFORM_COUNT] = {"chip8", "schip", "xochip"};
+
+// instructions per second: the usual 10 per frame for CHIP-8, 30 for
+// SUPER-CHIP, and Octo's 1000 for XO-CHIP
+const uint32_t PLATFORM_IPS[PLATFORM_COUNT] = {600, 1800, 60000};
+
+// parse_quirks() without the complaint; a stale line is just dropped
+bool parse_quirk_name(const std::string& name, QuirkProfile& quirks) {
+    for (int p = 0; p < QUIRKS_COUNT; ++p) {
+        if (name == quirks_name(static_cast<QuirkProfile>(p))) {
+            quirks = static_cast<QuirkProfile>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_platform(const std::string& name, RomPlatform& platform) {
+    for (int p = 0; p < PLATFORM_COUNT; ++p) {
+        if (name == PLATFORM_NAMES[p]) {
+            platform = static_cast<RomPlatform>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char* platform_name(RomPlatform platform) {
+    return platform < PLATFORM_COUNT ? PLATFORM_NAMES[platform] : "?";
+}
+
+uint32_t platform_ips(RomPlatform platform) {
+    return platform < PLATFORM_COUNT ? PLATFORM_IPS[platform] : PLATFORM_IPS[PLATFORM_CHIP8];
+}
+
+// plain CHIP-8 ROMs mostly run fine either way; modern is what they got
+// before there were profiles
+QuirkProfile platform_quirks(RomPlatform platform) {
+    switch (platform) {
+        case PLATFORM_SCHIP: return QUIRKS_SCHIP;
+        case PLATFORM_XOCHIP: return QUIRKS_XOCHIP;
+        default: return QUIRKS_MODERN;
+    }
+}
+
+// Only code the walk reaches counts, so sprite data that happens to look
+// like a SUPER-CHIP opcode doesn't make a ROM one.
+void analyse_rom(const uint8_t* bytes, size_t size, RomInfo& info) {
+    info.size = size;
+    info.hash = hash_rom_image(bytes, size);
+    info.features = 0;
+    info.instructions = 0;
+    size = std::min<size_t>(size, MEM_SIZE - PROGRAM_START);
+    const auto contains = [&](uint32_t address) {
+        return address >= PROGRAM_START && address + 2 <= PROGRAM_START + size;
+    };
+
+    bool schip = false, xochip = false;
+    std::vector<uint8_t> seen(MEM_SIZE);
+    std::vector<uint16_t> work = {PROGRAM_START};
+    while (!work.empty()) {
+        uint16_t at = work.back();
+        work.pop_back();
+        bool falls_through = true;
+        while (falls_through && contains(at) && !seen[at]) {
+            seen[at] = 1;
+            ++info.instructions;
+            const uint16_t opcode = (bytes[at - PROGRAM_START] << 8) | bytes[at - PROGRAM_START + 1];
+            const uint16_t nnn = opcode & 0x0FFF;
+            const uint8_t nn = opcode & 0xFF, n = opcode & 0xF;
+            uint16_t next = at + 2;
+            switch (opcode >> 12) {
+                case 0x0:
+                    if (opcode == 0x00EE || opcode == 0x00FD) { // return, SUPER-CHIP exit
+                        falls_through = false;
+                    }
+                    if ((opcode & 0xFFF0) == 0x00C0 || (opcode >= 0x00FB && opcode <= 0x00FF)) {
+                        schip = true;
+                    } else if ((opcode & 0xFFF0) == 0x00D0) {
+                        xochip = true; // scroll up
+                    }
+                    break;
+                case 0x1:
+                    work.push_back(nnn);
+                    falls_through = false;
+                    break;
+                case 0x2:
+                    work.push_back(nnn);
+                    break;
+                case 0x3: case 0x4: case 0x9:
+                    work.push_back(next + 2);
+                    break;
+                case 0x5:
+                    if (n == 0) {
+                        work.push_back(next + 2);
+                    } else if (n == 2 || n == 3) {
+                        xochip = true; // save/load a register range
+                    }
+                    break;
+                case 0xB:
+                    info.features |= ROM_COMPUTED_JUMPS;
+                    falls_through = false;
+                    break;
+                case 0xC:
+                    info.features |= ROM_RANDOM;
+                    break;
+                case 0xE:
+                    info.features |= ROM_READS_KEYS;
+                    work.push_back(next + 2);
+                    break;
+                case 0xF:
+                    if (opcode == 0xF000) {
+                        xochip = true; // I = the 16-bit word that follows
+                        next += 2;
+                    } else if (nn == 0x0A) {
+                        info.features |= ROM_READS_KEYS;
+                    } else if (nn == 0x18) {
+                        info.features |= ROM_SOUND;
+                    } else if (nn == 0x33 || nn == 0x55) {
+                        info.features |= ROM_STORES;
+                    } else if (nn == 0x30 || nn == 0x75 || nn == 0x85) {
+                        schip = true;
+                    } else if (nn == 0x01 || opcode == 0xF002 || nn == 0x3A) {
+                        xochip = true;
+                    }
+                    break;
+            }
+            at = next;
+        }
+    }
+    info.platform = xochip ? PLATFORM_XOCHIP : schip ? PLATFORM_SCHIP : PLATFORM_CHIP8;
+}
+
+RomLibrary::RomLibrary(const std::string& directory, const std::string& index_path)
+    : directory_(directory),
+      index_path_(index_path.empty() ? (std::filesystem::path(directory) / ".chip8_index").string() : index_path) {}
+
+std::string RomLibrary::path(const RomInfo& rom) const {
+    return (std::filesystem::path(directory_) / rom.file).string();
+}
+
+RomInfo* RomLibrary::find(const std::string& file) {
+    for (RomInfo& rom : roms_) {
+        if (rom.file == file) {
+            return &rom;
+        }
+    }
+    return nullptr;
+}
+
+// A missing index is an empty one; a line that doesn't parse is dropped,
+// and the ROM gets read again.
+bool RomLibrary::load_index(std::vector<RomInfo>& entries) const {
+    std::ifstream file(index_path_);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream in(line);
+        RomInfo rom;
+        std::string platform, quirks;
+        in >> std::hex >> rom.hash >> std::dec >> rom.size >> rom.modified >> platform >> rom.ips >> quirks >>
+            std::hex >> rom.features >> std::dec >> rom.instructions;
+        in >> std::ws;
+        std::getline(in, rom.file);
+        if (in.fail() || rom.file.empty() || !parse_platform(platform, rom.platform) ||
+            !parse_quirk_name(quirks, rom.quirks)) {
+            continue;
+        }
+        entries.push_back(rom);
+    }
+    return true;
+}
+
+bool RomLibrary::save() const {
+    std::ofstream file(index_path_);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << index_path_ << std::endl;
+        return false;
+    }
+    file << "# hash size time platform ips quirks features instructions file\n";
+    for (const RomInfo& rom : roms_) {
+        file << std::hex << rom.hash << std::dec << ' ' << rom.size << ' ' << rom.modified << ' '
+             << platform_name(rom.platform) << ' ' << rom.ips << ' ' << quirks_name(rom.quirks) << ' ' << std::hex
+             << rom.features << std::dec << ' ' << rom.instructions << ' ' << rom.file << '\n';
+    }
+    return file.good();
+}
+
+bool RomLibrary::refresh() {
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory_, error)) {
+        std::cerr << "Failed to open directory > " << directory_ << std::endl;
+        return false;
+    }
+    std::vector<RomInfo> known;
+    load_index(known);
+    std::map<std::string, const RomInfo*> by_file;
+    std::map<uint64_t, const RomInfo*> by_hash;
+    for (const RomInfo& rom : known) {
+        by_file[rom.file] = &rom;
+        by_hash[rom.hash] = &rom;
+    }
+
+    std::vector<RomInfo> roms;
+    analysed_ = 0;
+    for (const std::string& file : list_rom_files(directory_)) {
+        const std::filesystem::path filepath = std::filesystem::path(directory_) / file;
+        const uint64_t size = std::filesystem::file_size(filepath, error);
+        const auto time = std::filesystem::last_write_time(filepath, error);
+        if (error) {
+            continue;
+        }
+        const int64_t modified = static_cast<int64_t>(time.time_since_epoch().count());
+        const auto same = by_file.find(file);
+        if (same != by_file.end() && same->second->size == size && same->second->modified == modified) {
+            roms.push_back(*same->second);
+            continue;
+        }
+
+        MappedRom rom;
+        if (!rom.open(filepath.string())) {
+            continue;
+        }
+        RomInfo info;
+        info.file = file;
+        info.modified = modified;
+        analyse_rom(rom.data(), rom.size(), info);
+        const auto twin = by_hash.find(info.hash);
+        info.ips = twin != by_hash.end() ? twin->second->ips : platform_ips(info.platform);
+        info.quirks = twin != by_hash.end() ? twin->second->quirks : platform_quirks(info.platform);
+        roms.push_back(info);
+        ++analysed_;
+    }
+    roms_ = std::move(roms);
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef ROM_LIBRARY_H
+#define ROM_LIBRARY_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "quirks.h"
+
+// A ROM file mapped read-only into memory (mmap where there is one, read
+// into a buffer elsewhere). Loading one copies it once, into the shared
+// ROM pages (see PagedMemory::load_program()).
+class MappedRom {
+public:
+    MappedRom() = default;
+    ~MappedRom();
+    MappedRom(const MappedRom&) = delete;
+    MappedRom& operator=(const MappedRom&) = delete;
+
+    // error on stderr and false if the file can't be opened or mapped
+    bool open(const std::string& filepath);
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void close();
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<uint8_t> buffer_;   // where there's no mmap
+};
+
+// What a ROM was written for, going by the instructions it uses.
+enum RomPlatform : uint8_t {
+    PLATFORM_CHIP8,
+    PLATFORM_SCHIP,     // 00CN 00FB-00FF FX30 FX75 FX85
+    PLATFORM_XOCHIP,    // 5XY2 5XY3 F000 NNNN FN01 F002 FX3A
+    PLATFORM_COUNT
+};
+
+const char* platform_name(RomPlatform platform);
+// the usual speed and quirks for ROMs written for it
+uint32_t platform_ips(RomPlatform platform);
+QuirkProfile platform_quirks(RomPlatform platform);
+
+// What the ROM's reachable code does, as ROM_* bits.
+enum RomFeature : uint32_t {
+    ROM_READS_KEYS = 1 << 0,        // EX9E EXA1 FX0A
+    ROM_SOUND = 1 << 1,             // FX18
+    ROM_RANDOM = 1 << 2,            // CXNN
+    ROM_STORES = 1 << 3,            // FX33 FX55, so possibly self-modifying
+    ROM_COMPUTED_JUMPS = 1 << 4,    // BNNN, so the walk may have missed code
+};
+
+struct RomInfo {
+    std::string file;           // name inside the library's directory
+    uint64_t hash = 0;          // hash_rom() of a machine that just loaded it
+    uint64_t size = 0;
+    int64_t modified = 0;       // file time, only ever compared for equality
+    RomPlatform platform = PLATFORM_CHIP8;
+    uint32_t ips = 0;           // preferred speed; the platform's until changed
+    QuirkProfile quirks = QUIRKS_MODERN;    // likewise
+    uint32_t features = 0;
+    uint32_t instructions = 0;  // reachable from PROGRAM_START
+};
+
+// Fills in everything but file, modified, ips and quirks by following control flow
+// from PROGRAM_START, the way tools/chip8_aot.cpp finds code.
+void analyse_rom(const uint8_t* bytes, size_t size, RomInfo& info);
+
+// The ROMs in a directory and what is known about each, kept in an index
+// file between runs. refresh() only reads files that are new or whose size
+// or time changed, so a library that hasn't changed costs one directory
+// listing. Settings (ips, quirks) follow a ROM's contents: a renamed or
+// copied ROM keeps them.
+//
+// Index: a comment line, then one ROM per line,
+//   <hash> <size> <time> <platform> <ips> <quirks> <features> <instructions> <file>
+// hash and features in hex; the file name is the rest of the line.
+class RomLibrary {
+public:
+    // index_path empty = ".chip8_index" in the directory
+    explicit RomLibrary(const std::string& directory, const std::string& index_path = "");
+
+    // reads the index, then brings it up to date with the directory; false
+    // if the directory can't be listed
+    bool refresh();
+    bool save() const;
+
+    const std::vector<RomInfo>& roms() const { return roms_; }
+    RomInfo* find(const std::string& file);
+    std::string path(const RomInfo& rom) const;
+    // ROMs the last refresh() had to read
+    size_t analysed() const { return analysed_; }
+
+private:
+    bool load_index(std::vector<RomInfo>& entries) const;
+
+    std::string directory_;
+    std::string index_path_;
+    std::vector<RomInfo> roms_;
+    size_t analysed_ = 0;
+};
+
+#endif // ROM_LIBRARY_H
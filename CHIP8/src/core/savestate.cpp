@@ -0,0 +1,244 @@
+#include "savestate.h"
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+template <typename T>
+void put(uint8_t*& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(*in++) << (8 * i);
+    }
+    return value;
+}
+
+void put_u32(std::ofstream& file, uint32_t value) {
+    uint8_t bytes[4];
+    uint8_t* out = bytes;
+    put(out, value);
+    file.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+bool get_u32(std::ifstream& file, uint32_t& value) {
+    uint8_t bytes[4];
+    if (!file.read(reinterpret_cast<char*>(bytes), 4)) {
+        return false;
+    }
+    const uint8_t* in = bytes;
+    value = get<uint32_t>(in);
+    return true;
+}
+
+// where planes and hires sit in the image
+constexpr size_t SCREEN_MODE_OFFSET = 8 + NUM_REGISTERS + STACK_SIZE * 2 + NUM_KEYS + 8 + 8 + 1 + AUDIO_PATTERN_SIZE;
+
+bool page_present(const uint8_t* bitmap, size_t page) {
+    return (bitmap[page / 8] >> (page % 8)) & 1;
+}
+
+size_t pages_present(const uint8_t* bitmap) {
+    size_t count = 0;
+    for (size_t i = 0; i < STATE_BITMAP_SIZE; ++i) {
+        count += std::popcount(bitmap[i]);
+    }
+    return count;
+}
+
+// An sp the opcodes would index the stack with unchecked (00EE only tests
+// sp > 0), screen modes no machine can be in, and pages the image doesn't
+// hold. pc and I need no check: every fetch masks pc to the code space,
+// and all of a u16 I is inside the 64 KB memory.
+bool state_is_valid(const StateImage& image) {
+    if (image.size() < STATE_HEADER_SIZE + STATE_BITMAP_SIZE
+        || image.size() != STATE_HEADER_SIZE + STATE_BITMAP_SIZE
+                               + pages_present(image.data() + STATE_HEADER_SIZE) * MEMORY_PAGE_SIZE) {
+        return false;
+    }
+    const uint8_t* in = image.data();
+    in += 4; // pc, I
+    const uint16_t sp = get<uint16_t>(in);
+    in = image.data() + SCREEN_MODE_OFFSET;
+    const uint8_t planes = get<uint8_t>(in);
+    const uint8_t hires = get<uint8_t>(in);
+    return sp <= STACK_SIZE && planes < (1 << NUM_PLANES) && hires <= 1;
+}
+
+} // namespace
+
+void capture_state(const Chip8& chip8, StateImage& image) {
+    const PagedMemory& memory = chip8.memory;
+    uint8_t bitmap[STATE_BITMAP_SIZE] = {};
+    for (size_t page = 0; page < MEMORY_PAGES; ++page) {
+        const uint8_t* bytes = memory.page(page);
+        if (std::any_of(bytes, bytes + MEMORY_PAGE_SIZE, [](uint8_t byte) { return byte != 0; })) {
+            bitmap[page / 8] |= 1 << (page % 8);
+        }
+    }
+    image.resize(STATE_HEADER_SIZE + STATE_BITMAP_SIZE + pages_present(bitmap) * MEMORY_PAGE_SIZE);
+    uint8_t* out = image.data();
+    put(out, chip8.pc);
+    put(out, chip8.i_reg);
+    put(out, chip8.sp);
+    put(out, chip8.delay_timer);
+    put(out, chip8.sound_timer);
+    for (uint8_t v : chip8.v_regs) {
+        put(out, v);
+    }
+    for (uint16_t address : chip8.stack) {
+        put(out, address);
+    }
+    for (bool key : chip8.keypad) {
+        put<uint8_t>(out, key);
+    }
+    put(out, chip8.cycles);
+    put(out, chip8.rng_state);
+    put(out, chip8.pitch);
+    for (uint8_t byte : chip8.audio_pattern) {
+        put(out, byte);
+    }
+    put(out, chip8.planes);
+    put<uint8_t>(out, chip8.screen.hires);
+    for (uint8_t flag : chip8.rpl_flags) {
+        put(out, flag);
+    }
+    for (const Framebuffer::Plane& plane : chip8.screen.planes) {
+        for (const Framebuffer::Row& row : plane) {
+            for (uint64_t word : row) {
+                put(out, word);
+            }
+        }
+    }
+    out = std::copy(bitmap, bitmap + STATE_BITMAP_SIZE, out);
+    for (size_t page = 0; page < MEMORY_PAGES; ++page) {
+        if (page_present(bitmap, page)) {
+            out = std::copy(memory.page(page), memory.page(page) + MEMORY_PAGE_SIZE, out);
+        }
+    }
+}
+
+bool restore_state(Chip8& chip8, const StateImage& image) {
+    if (!state_is_valid(image)) {
+        return false;
+    }
+    const uint8_t* in = image.data();
+    chip8.pc = get<uint16_t>(in);
+    chip8.i_reg = get<uint16_t>(in);
+    chip8.sp = get<uint16_t>(in);
+    chip8.delay_timer = get<uint8_t>(in);
+    chip8.sound_timer = get<uint8_t>(in);
+    for (uint8_t& v : chip8.v_regs) {
+        v = get<uint8_t>(in);
+    }
+    for (uint16_t& address : chip8.stack) {
+        address = get<uint16_t>(in);
+    }
+    for (bool& key : chip8.keypad) {
+        key = get<uint8_t>(in) != 0;
+    }
+    chip8.cycles = get<uint64_t>(in);
+    chip8.rng_state = get<uint64_t>(in);
+    chip8.pitch = get<uint8_t>(in);
+    for (uint8_t& byte : chip8.audio_pattern) {
+        byte = get<uint8_t>(in);
+    }
+    chip8.planes = get<uint8_t>(in);
+    chip8.screen.hires = get<uint8_t>(in) != 0;
+    for (uint8_t& flag : chip8.rpl_flags) {
+        flag = get<uint8_t>(in);
+    }
+    for (Framebuffer::Plane& plane : chip8.screen.planes) {
+        for (Framebuffer::Row& row : plane) {
+            for (uint64_t& word : row) {
+                word = get<uint64_t>(in);
+            }
+        }
+    }
+    // pages left out are zero; writing zeroes over a shared zero page
+    // leaves it shared
+    static constexpr PagedMemory::Page ZERO_PAGE{};
+    const uint8_t* bitmap = in;
+    in += STATE_BITMAP_SIZE;
+    for (size_t page = 0; page < MEMORY_PAGES; ++page) {
+        const uint8_t* bytes = ZERO_PAGE.data();
+        if (page_present(bitmap, page)) {
+            bytes = in;
+            in += MEMORY_PAGE_SIZE;
+        }
+        chip8.memory.write(static_cast<uint16_t>(page * MEMORY_PAGE_SIZE), bytes, MEMORY_PAGE_SIZE);
+    }
+    chip8.invalidate_decode_cache();
+    return true;
+}
+
+uint64_t hash_state(const Chip8& chip8) {
+    StateImage image;
+    capture_state(chip8, image);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : image) {
+        hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool save_state(const Chip8& chip8, const std::string& filepath) {
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    StateImage image;
+    capture_state(chip8, image);
+    file.write(SAVESTATE_MAGIC, 4);
+    put_u32(file, SAVESTATE_VERSION);
+    put_u32(file, static_cast<uint32_t>(image.size()));
+    file.write(reinterpret_cast<const char*>(image.data()), image.size());
+    if (!file) {
+        std::cerr << "Can't write that file > " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_state(Chip8& chip8, const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t size = 0;
+    if (!file.read(magic, 4) || !std::equal(magic, magic + 4, SAVESTATE_MAGIC)
+        || !get_u32(file, version) || !get_u32(file, size)) {
+        std::cerr << "Not a CHIP-8 save state > " << filepath << std::endl;
+        return false;
+    }
+    if (version != SAVESTATE_VERSION) {
+        std::cerr << "Unsupported save state version " << version << std::endl;
+        return false;
+    }
+    if (size > MAX_STATE_SIZE) {
+        std::cerr << "Save state is damaged > " << filepath << std::endl;
+        return false;
+    }
+    StateImage image(size);
+    if (!file.read(reinterpret_cast<char*>(image.data()), image.size())) {
+        std::cerr << "Save state is truncated > " << filepath << std::endl;
+        return false;
+    }
+    if (!restore_state(chip8, image)) {
+        std::cerr << "Save state is damaged > " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
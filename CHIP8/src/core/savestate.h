@@ -0,0 +1,49 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+#include "chip8.h"
+#include <string>
+#include <vector>
+
+// A machine's whole state as a flat byte image. Multi-byte fields are
+// little-endian regardless of host. Memory comes last and only in part:
+// a bitmap of its 256-byte pages, then just the pages that aren't all
+// zero, in order. A CHIP-8 program's image is a few KB rather than the
+// 68 KB a full XO-CHIP memory would take.
+//
+//   0  pc u16, i_reg u16, sp u16, delay_timer u8, sound_timer u8
+//   8  v_regs[16]
+//  24  stack[16] u16
+//  56  keypad[16] (0/1)
+//  72  cycles u64
+//  80  rng_state u64
+//  88  pitch u8, audio_pattern[16]
+// 105  planes u8, hires u8, rpl_flags[16]
+// 123  screen planes[2], each rows[64] of two u64
+// 2171 page bitmap[32], bit n % 8 of byte n / 8 set = page n follows
+// 2203 the non-zero pages
+constexpr size_t STATE_HEADER_SIZE = 8 + NUM_REGISTERS + STACK_SIZE * 2 + NUM_KEYS + 8 + 8 + 1 +
+                                     AUDIO_PATTERN_SIZE + 2 + NUM_RPL_FLAGS + sizeof(Framebuffer::planes);
+constexpr size_t STATE_BITMAP_SIZE = MEMORY_PAGES / 8;
+// with every page present
+constexpr size_t MAX_STATE_SIZE = STATE_HEADER_SIZE + STATE_BITMAP_SIZE + MEM_SIZE;
+
+using StateImage = std::vector<uint8_t>;
+
+// resizes image to fit; a reused image only reallocates to grow
+void capture_state(const Chip8& chip8, StateImage& image);
+// replaces everything capture_state() covers and drops cached translations;
+// false, with the machine left as it was, for an image no machine could
+// have produced (sp past the stack, a screen mode that doesn't exist, a
+// size that doesn't match its bitmap)
+bool restore_state(Chip8& chip8, const StateImage& image);
+// FNV-1a over the state image; equal hashes = identical machines
+uint64_t hash_state(const Chip8& chip8);
+
+// Save file: "C8SS", u32 version, u32 image size, image.
+constexpr char SAVESTATE_MAGIC[4] = {'C', '8', 'S', 'S'};
+constexpr uint32_t SAVESTATE_VERSION = 5;
+
+bool save_state(const Chip8& chip8, const std::string& filepath);
+bool load_state(Chip8& chip8, const std::string& filepath);
+
+#endif // SAVESTATE_H
@@ -0,0 +1,101 @@
+#include "scheduler.h"
+#include "debugger.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+using ticks_60hz = std::chrono::duration<uint64_t, std::ratio<1, Scheduler::TIMER_HZ>>;
+
+// how many events at `rate` per second fit into `elapsed`, split so that
+// long sessions at high rates don't overflow
+uint64_t events_in(Scheduler::clock::duration elapsed, uint64_t rate) {
+    const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return ns / 1000000000 * rate + ns % 1000000000 * rate / 1000000000;
+}
+
+} // namespace
+
+Scheduler::Scheduler(uint32_t ips) : ips_(std::max<uint32_t>(ips, 1)) {}
+
+// Rate and mode changes restart the schedule at the next slice; at most a
+// fraction of one tick is lost.
+void Scheduler::set_ips(uint32_t ips) {
+    ips = std::max<uint32_t>(ips, 1);
+    if (ips != ips_) {
+        ips_ = ips;
+        started_ = false;
+    }
+}
+
+void Scheduler::set_turbo(bool on) {
+    if (on != turbo_) {
+        turbo_ = on;
+        started_ = false;
+    }
+}
+
+void Scheduler::rebase(clock::time_point now) {
+    origin_ = now;
+    ticks_ = 0;
+    executed_ = 0;
+    started_ = true;
+}
+
+Scheduler::clock::time_point Scheduler::tick_time(uint64_t tick) const {
+    return origin_ + std::chrono::duration_cast<clock::duration>(ticks_60hz(tick));
+}
+
+// Only what actually ran is charged; a debugger stop ends the slice's
+// instructions early.
+void Scheduler::run_to(Chip8& chip8, uint64_t target) {
+    while (executed_ < target) {
+        const int count = static_cast<int>(std::min<uint64_t>(target - executed_, INT_MAX));
+        const int ran = chip8.run(count);
+        executed_ += ran;
+        if (ran < count) {
+            break;
+        }
+    }
+}
+
+// A paused machine's timers stand still with it, and the time it spends
+// paused isn't caught up on afterwards.
+void Scheduler::tick_timers(Chip8& chip8) {
+    if (chip8.debugger && chip8.debugger->paused()) {
+        started_ = false;
+        return;
+    }
+    chip8.update_timers();
+}
+
+Scheduler::clock::time_point Scheduler::run_slice(Chip8& chip8, Backend& backend, clock::time_point now) {
+    if (!started_) {
+        rebase(now);
+    }
+    backend.poll_input(chip8);
+
+    if (turbo_) {
+        ++ticks_;
+        run_to(chip8, cycles_at_tick(ticks_));
+        tick_timers(chip8);
+    } else {
+        uint64_t due_ticks = events_in(now - origin_, TIMER_HZ);
+        if (due_ticks > ticks_ + MAX_CATCH_UP_TICKS) {
+            // slide the origin forward past the time we won't replay
+            origin_ += std::chrono::duration_cast<clock::duration>(ticks_60hz(due_ticks - ticks_ - MAX_CATCH_UP_TICKS));
+            due_ticks = ticks_ + MAX_CATCH_UP_TICKS;
+        }
+        while (ticks_ < due_ticks) {
+            ++ticks_;
+            run_to(chip8, cycles_at_tick(ticks_));
+            tick_timers(chip8);
+        }
+        // and whatever part of the next tick has already elapsed
+        run_to(chip8, events_in(now - origin_, ips_));
+    }
+
+    backend.set_sound(chip8);
+    backend.present(chip8);
+    return turbo_ ? now : tick_time(ticks_ + 1);
+}
@@ -0,0 +1,59 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include "backend.h"
+#include <chrono>
+
+// Decides how many instructions to run and when the 60 Hz timers tick,
+// from a monotonic clock instead of from how often the host loop spins.
+//
+// Instruction n is due at n / ips seconds and timer tick k at k / 60
+// seconds, both counted from the same origin, so CPU speed and timer speed
+// are independent of each other and of the display rate. Instructions are
+// run up to each tick boundary before the timers are decremented, so a
+// ROM polling DT sees the same number of instructions per tick whether the
+// host calls in every millisecond or once per second.
+//
+// In turbo mode the clock is ignored: every slice runs exactly one tick's
+// worth of instructions and returns immediately, which is as fast as the
+// host allows while keeping the instruction-to-timer ratio intact.
+class Scheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t DEFAULT_IPS = 600;
+    static constexpr uint32_t TIMER_HZ = 60;
+    // After a longer stall (debugger, window drag, suspended laptop) the
+    // missed time is dropped rather than replayed at full speed.
+    static constexpr uint32_t MAX_CATCH_UP_TICKS = 15;
+
+    explicit Scheduler(uint32_t ips = DEFAULT_IPS);
+
+    void set_ips(uint32_t ips);
+    uint32_t ips() const { return ips_; }
+    void set_turbo(bool on);
+    bool turbo() const { return turbo_; }
+    // start a fresh schedule at the next slice, e.g. after the machine state
+    // was replaced, so the time spent elsewhere isn't caught up on
+    void restart() { started_ = false; }
+
+    // Polls input, runs every instruction and timer tick due by `now`, then
+    // updates sound and presents. Returns when the next timer tick is due;
+    // a caller that isn't in turbo mode can sleep until then.
+    clock::time_point run_slice(Chip8& chip8, Backend& backend, clock::time_point now);
+
+private:
+    void rebase(clock::time_point now);
+    void run_to(Chip8& chip8, uint64_t target);
+    void tick_timers(Chip8& chip8);
+    uint64_t cycles_at_tick(uint64_t tick) const { return tick * ips_ / TIMER_HZ; }
+    clock::time_point tick_time(uint64_t tick) const;
+
+    uint32_t ips_;
+    bool turbo_ = false;
+    bool started_ = false;
+    clock::time_point origin_{};
+    uint64_t ticks_ = 0;      // timer ticks done since origin_
+    uint64_t executed_ = 0;   // instructions done since origin_
+};
+
+#endif // SCHEDULER_H
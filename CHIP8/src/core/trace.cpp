@@ -0,0 +1,161 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+template <typename T>
+void put(uint8_t*& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(*in++) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+void encode_trace_record(const TraceRecord& record, uint8_t* out) {
+    put(out, record.cycle);
+    put(out, record.pc);
+    put(out, record.opcode);
+    put(out, record.touched);
+    put(out, record.category);
+    put(out, record.level);
+}
+
+TraceRecord decode_trace_record(const uint8_t* in) {
+    TraceRecord record;
+    record.cycle = get<uint64_t>(in);
+    record.pc = get<uint16_t>(in);
+    record.opcode = get<uint16_t>(in);
+    record.touched = get<uint16_t>(in);
+    record.category = get<uint8_t>(in);
+    record.level = get<uint8_t>(in);
+    return record;
+}
+
+Tracer::Tracer(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring_.resize(size);
+    mask_ = size - 1;
+}
+
+Tracer::~Tracer() {
+    stop();
+}
+
+bool Tracer::start(const std::string& filepath) {
+    stop();
+    file_ = std::fopen(filepath.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Failed to open trace file > " << filepath << std::endl;
+        return false;
+    }
+    uint8_t header[12];
+    uint8_t* out = header;
+    for (char c : TRACE_MAGIC) {
+        put(out, static_cast<uint8_t>(c));
+    }
+    put(out, TRACE_VERSION);
+    put(out, static_cast<uint32_t>(sizeof(TraceRecord)));
+    std::fwrite(header, 1, sizeof(header), file_);
+
+    running_ = true;
+    writer_ = std::thread([this] {
+        while (running_.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        drain();
+    });
+    return true;
+}
+
+void Tracer::stop() {
+    if (writer_.joinable()) {
+        running_.store(false, std::memory_order_release);
+        writer_.join();
+    }
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+// writer thread only
+void Tracer::drain() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (tail != head) {
+        size_t start = tail & mask_;
+        size_t count = std::min<uint64_t>(head - tail, ring_.size() - start); // up to the wrap
+        encoded_.resize(count * sizeof(TraceRecord));
+        for (size_t k = 0; k < count; ++k) {
+            encode_trace_record(ring_[start + k], &encoded_[k * sizeof(TraceRecord)]);
+        }
+        std::fwrite(encoded_.data(), 1, encoded_.size(), file_);
+        tail += count;
+        tail_.store(tail, std::memory_order_release);
+    }
+    std::fflush(file_);
+}
+
+uint8_t parse_trace_categories(const std::string& list) {
+    uint8_t categories = 0;
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        if (name == "cpu") {
+            categories |= TRACE_CPU;
+        } else if (name == "draw") {
+            categories |= TRACE_DRAW;
+        } else if (name == "flow") {
+            categories |= TRACE_FLOW;
+        } else if (name == "error") {
+            categories |= TRACE_ERROR;
+        } else if (name == "all") {
+            categories |= TRACE_ALL;
+        } else {
+            std::cerr << "Unknown trace category > " << name << std::endl;
+            return 0;
+        }
+    }
+    return categories;
+}
+
+const char* trace_category_name(uint8_t category) {
+    switch (category) {
+        case TRACE_CPU: return "cpu";
+        case TRACE_DRAW: return "draw";
+        case TRACE_FLOW: return "flow";
+        case TRACE_ERROR: return "error";
+        default: return "?";
+    }
+}
+
+bool parse_trace_level(const std::string& name, TraceLevel& level) {
+    if (name == "error") {
+        level = TRACE_LEVEL_ERROR;
+    } else if (name == "info") {
+        level = TRACE_LEVEL_INFO;
+    } else if (name == "debug") {
+        level = TRACE_LEVEL_DEBUG;
+    } else {
+        std::cerr << "Unknown trace level > " << name << std::endl;
+        return false;
+    }
+    return true;
+}
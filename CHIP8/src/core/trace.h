@@ -0,0 +1,100 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum TraceCategory : uint8_t {
+    TRACE_CPU = 1 << 0,    // every instruction
+    TRACE_DRAW = 1 << 1,   // 00E0, DXYN
+    TRACE_FLOW = 1 << 2,   // jumps to self and other control-flow oddities
+    TRACE_ERROR = 1 << 3,  // unknown opcodes, stack over/underflow
+    TRACE_ALL = 0xFF
+};
+
+enum TraceLevel : uint8_t {
+    TRACE_LEVEL_ERROR,
+    TRACE_LEVEL_INFO,
+    TRACE_LEVEL_DEBUG
+};
+
+// One fixed-size binary record; the trace file is a header ("C8TR", u32
+// version, u32 record size) and then these, every field little-endian
+// whatever the host, in the order declared.
+struct TraceRecord {
+    uint64_t cycle;
+    uint16_t pc;        // address of the instruction
+    uint16_t opcode;
+    uint16_t touched;   // bit n set = instruction reads or writes Vn
+    uint8_t category;
+    uint8_t level;
+};
+static_assert(sizeof(TraceRecord) == 16);
+
+constexpr char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+constexpr uint32_t TRACE_VERSION = 2;
+
+// to and from the file's byte order; TraceRecord's size in both
+void encode_trace_record(const TraceRecord& record, uint8_t* out);
+TraceRecord decode_trace_record(const uint8_t* in);
+
+// Records go into a preallocated single-producer/single-consumer ring and a
+// background thread writes them out. The producer never blocks: when the
+// ring is full, records are counted as dropped. One thread may emit into a
+// tracer (any number of machines on that thread can share it).
+class Tracer {
+public:
+    explicit Tracer(size_t capacity = 1 << 16);
+    ~Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    bool start(const std::string& filepath);
+    void stop();
+
+    void enable(uint8_t categories, TraceLevel max_level) {
+        categories_ = categories;
+        max_level_ = max_level;
+    }
+    bool wants(TraceCategory category, TraceLevel level) const {
+        return (categories_ & category) && level <= max_level_;
+    }
+
+    void emit(const TraceRecord& record) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == ring_.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring_[head & mask_] = record;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void drain();
+
+    std::vector<TraceRecord> ring_;
+    uint64_t mask_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> running_{false};
+    uint8_t categories_ = 0;
+    TraceLevel max_level_ = TRACE_LEVEL_ERROR;
+    std::FILE* file_ = nullptr;
+    std::vector<uint8_t> encoded_;  // writer only
+    std::thread writer_;
+};
+
+// "cpu,draw,flow,error" or "all" -> TraceCategory bits; 0 on a bad name
+uint8_t parse_trace_categories(const std::string& list);
+const char* trace_category_name(uint8_t category);
+// "error", "info" or "debug"; false on anything else
+bool parse_trace_level(const std::string& name, TraceLevel& level);
+
+#endif // TRACE_H
@@ -0,0 +1,47 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of whole values from one writer thread to one reader
+// thread. The writer fills back() and publish()es it; the reader calls
+// update() and then looks at front(). Neither side ever waits for the other:
+// the third slot means there is always a free buffer to write into, and a
+// reader that falls behind simply skips to the newest value.
+template <typename T>
+class TripleBuffer {
+public:
+    T& back() { return slots_[back_].value; }
+    const T& front() const { return slots_[front_].value; }
+
+    // writer: swap the filled back buffer with the middle one
+    void publish() {
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader: take the middle buffer if something newer was published since
+    // the last call; false (and front() unchanged) otherwise
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    // each slot on its own cache lines so the two threads don't false-share
+    struct alignas(64) Slot {
+        T value{};
+    };
+    Slot slots_[3];
+
+    alignas(64) std::atomic<uint8_t> middle_{1};
+    alignas(64) uint8_t back_ = 0;    // writer only
+    alignas(64) uint8_t front_ = 2;   // reader only
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,70 @@
+#include "work_pool.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct TaskQueue {
+    std::mutex lock;
+    std::deque<size_t> tasks;
+};
+
+} // namespace
+
+WorkPool::WorkPool(unsigned threads) : threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+void WorkPool::run(std::vector<std::function<void()>> tasks) {
+    const unsigned workers = std::max(1u, std::min<unsigned>(threads_, tasks.size()));
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    for (unsigned w = 0; w < workers; ++w) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        queues[i % workers]->tasks.push_back(i);
+    }
+    executed_.assign(workers, 0);
+    stolen_.assign(workers, 0);
+
+    // Own work in the order given, so the long tasks start early; stolen
+    // work from the far end, which is the other worker's shortest. Tasks
+    // never add tasks, so a worker that finds every queue empty is done.
+    const auto work = [&](unsigned self) {
+        for (;;) {
+            size_t task = 0;
+            bool found = false;
+            for (unsigned k = 0; k < workers && !found; ++k) {
+                TaskQueue& queue = *queues[(self + k) % workers];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.tasks.empty()) {
+                    continue;
+                }
+                if (k == 0) {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                } else {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                    ++stolen_[self];
+                }
+                found = true;
+            }
+            if (!found) {
+                return;
+            }
+            tasks[task]();
+            ++executed_[self];
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers; ++w) {
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+#include <functional>
+#include <vector>
+
+// Runs a batch of independent tasks on a fixed number of threads. Tasks are
+// dealt out round-robin, one deque per worker; a worker works through its
+// own from the front and, once that's empty, steals from the back of the
+// others', so one slow task doesn't leave a queue of short ones stuck
+// behind it. Nothing is shared between tasks but what they share themselves.
+class WorkPool {
+public:
+    // 0 = one per hardware thread
+    explicit WorkPool(unsigned threads = 0);
+
+    unsigned threads() const { return threads_; }
+
+    // runs every task (the calling thread is one of the workers) and
+    // returns once all of them have finished; put the longest ones first
+    void run(std::vector<std::function<void()>> tasks);
+
+    // tasks each worker ran in the last run(), stolen ones included
+    const std::vector<size_t>& executed() const { return executed_; }
+    // tasks each worker took from another worker's queue
+    const std::vector<size_t>& stolen() const { return stolen_; }
+
+private:
+    unsigned threads_;
+    std::vector<size_t> executed_;
+    std::vector<size_t> stolen_;
+};
+
+#endif // WORK_POOL_H
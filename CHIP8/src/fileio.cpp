@@ -1,26 +0,0 @@
-#include "chip8.h"
-#include <iostream>
-#include <fstream>
-
-bool load_chip8_file(const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file > " << filepath << std::endl;
-        return false;
-    }
-
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    if (static_cast<size_t>(size) > (MEM_SIZE - 0x200)) {
-        std::cerr << "File too large..." << std::endl;
-        return false;
-    }
-
-    if (!file.read(reinterpret_cast<char*>(&memory[0x200]), size)) {
-        std::cerr << "Can't read that file > " << filepath << std::endl;
-        return false;
-    }
-
-    return true;
-}
\ No newline at end of file
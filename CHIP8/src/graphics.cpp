@@ -1,61 +1,128 @@
-#include "chip8.h"
+#include "raylib_backend.h"
 #include <iostream>
-#include <cmath>
+#include <algorithm>
+#include <chrono>
 
-// Raylib stuff
-bool window_initialized = false;
-Vector2 screen_size = { SWIDTH, SHEIGHT };
-Sound beep;
-bool audio_initialized = false;
+const std::map<int, uint8_t> keymap = {
+    {KEY_ONE, 0x1}, {KEY_TWO, 0x2}, {KEY_THREE, 0x3}, {KEY_FOUR, 0xC},
+    {KEY_Q, 0x4}, {KEY_W, 0x5}, {KEY_E, 0x6}, {KEY_R, 0xD},
+    {KEY_A, 0x7}, {KEY_S, 0x8}, {KEY_D, 0x9}, {KEY_F, 0xE},
+    {KEY_Z, 0xA}, {KEY_X, 0x0}, {KEY_C, 0xB}, {KEY_V, 0xF}
+};
 
-void render_screen() {
-    const int scaleup = 15;
-    BeginDrawing();
-    ClearBackground(BLACK);
+namespace {
+
+// by pixel_at(): off, plane 0 (the one plain CHIP-8 draws in), plane 1, both
+constexpr Color palette[1 << NUM_PLANES] = {BLACK, GREEN, ORANGE, RAYWHITE};
+
+// raylib's stream callback takes no context; there is one audio device
+AudioSynth* streaming_synth = nullptr;
+
+// runs on the audio device's thread
+void fill_stream(void* buffer, unsigned int frames) {
+    streaming_synth->fill(static_cast<int16_t*>(buffer), frames);
+}
 
-    for (size_t y = 0; y < SHEIGHT; ++y) {
-        for (size_t x = 0; x < SWIDTH; ++x) {
-            if (screen[y][x]) {
-                DrawRectangle(x * scaleup, y * scaleup, scaleup, scaleup, GREEN);
+} // namespace
+
+// The screen lives in a 128x64 texture, a lores screen in its top-left
+// quarter, that is drawn as one scaled quad, so a frame costs a single draw
+// call. Each pixel's two plane bits pick one of four colors. The texture is
+// only re-uploaded when the framebuffer differs from what was last sent to
+// the GPU, and then only the rows the current mode shows. The quad
+// itself still goes out every frame: EndDrawing() swaps buffers and polls
+// input, so skipping it would leave a stale back buffer on screen.
+void RaylibBackend::draw(const Framebuffer& screen, const std::string& overlay, const DebugView* debug, size_t cursor) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!uploaded || screen != last_uploaded) {
+        for (size_t y = 0; y < screen.height(); ++y) {
+            for (size_t x = 0; x < screen.width(); ++x) {
+                pixels[y * SWIDTH + x] = palette[pixel_at(screen, x, y)];
             }
         }
+        UpdateTexture(screen_texture, pixels.data());
+        last_uploaded = screen;
+        uploaded = true;
     }
 
+    BeginDrawing();
+    const Rectangle source = { 0, 0, static_cast<float>(screen.width()), static_cast<float>(screen.height()) };
+    const Rectangle dest = { 0, 0, static_cast<float>(GetScreenWidth() - panel_width), static_cast<float>(GetScreenHeight()) };
+    DrawTexturePro(screen_texture, source, dest, Vector2{ 0, 0 }, 0.0f, WHITE);
+    if (!overlay.empty()) {
+        const int font_size = 20;
+        const int lines = 1 + static_cast<int>(std::count(overlay.begin(), overlay.end(), '\n'));
+        DrawRectangle(0, 0, MeasureText(overlay.c_str(), font_size) + 20, lines * (font_size + 2) + 16, Fade(BLACK, 0.6f));
+        DrawText(overlay.c_str(), 10, 8, font_size, RAYWHITE);
+    }
+    if (debug && panel_width > 0) {
+        draw_debug_panel(*debug, cursor);
+    }
+    last_draw_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
     EndDrawing();
 }
 
-bool init_raylib() {
+// format_debug_view()'s text a line at a time: pc's line highlighted,
+// breakpoints in red, the cursor (where F2 toggles a breakpoint) boxed.
+void RaylibBackend::draw_debug_panel(const DebugView& view, size_t cursor) {
+    const int font_size = 16;
+    const int line_height = 19;
+    const int left = GetScreenWidth() - panel_width;
+    DrawRectangle(left, 0, panel_width, GetScreenHeight(), Color{ 24, 24, 24, 255 });
+
+    const std::string text = format_debug_view(view);
+    const size_t listing_start = static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) - view.listing.size();
+    int y = 8;
+    size_t line_no = 0;
+    for (size_t start = 0, end; (end = text.find('\n', start)) != std::string::npos; start = end + 1, ++line_no) {
+        const std::string line = text.substr(start, end - start);
+        Color color = line_no == 0 ? YELLOW : RAYWHITE;
+        if (line_no >= listing_start) {
+            const DebugView::Line& entry = view.listing[line_no - listing_start];
+            if (entry.address == view.pc) {
+                DrawRectangle(left, y - 2, panel_width, line_height, DARKGRAY);
+            }
+            if (line_no - listing_start == cursor) {
+                DrawRectangleLines(left + 2, y - 2, panel_width - 4, line_height, GRAY);
+            }
+            color = entry.breakpoint ? RED : LIGHTGRAY;
+        }
+        DrawText(line.c_str(), left + 10, y, font_size, color);
+        y += line_height;
+    }
+}
+
+void RaylibBackend::present(const Chip8& chip8) {
+    draw(chip8.screen);
+}
+
+bool RaylibBackend::init_raylib(int panel_width) {
     std::cerr << "Initializing Raylib... " << std::endl;
     
-    const int scaleup = 15;
-    InitWindow(SWIDTH * scaleup, SHEIGHT * scaleup, ">_ CHIP-8 Interpreter in Raylib.");
+    const int scaleup = 8;
+    this->panel_width = panel_width;
+    InitWindow(SWIDTH * scaleup + panel_width, SHEIGHT * scaleup, ">_ CHIP-8 Interpreter in Raylib.");
     SetTargetFPS(60);
 
-    // audio stuff
+    Image image = {
+        .data = pixels.data(),
+        .width = SWIDTH,
+        .height = SHEIGHT,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+    screen_texture = LoadTextureFromImage(image);
+    SetTextureFilter(screen_texture, TEXTURE_FILTER_POINT);
+
+    // audio stuff: the stream pulls samples from the synth as it needs them
     InitAudioDevice();
     if (IsAudioDeviceReady()) {
         audio_initialized = true;
-        const unsigned int sampleRate = 44100;
-        const unsigned int seconds = 1;
-        Wave wave = {
-            .frameCount = sampleRate * seconds,
-            .sampleRate = sampleRate,
-            .sampleSize = 16,
-            .channels = 1,
-            .data = nullptr
-        };
-        
-        wave.data = malloc(wave.frameCount * sizeof(short));
-
-        // 440Hz sine wave
-        short* samples = static_cast<short*>(wave.data);
-        for (unsigned int i = 0; i < wave.frameCount; i++) {
-            float time = static_cast<float>(i) / sampleRate;
-            samples[i] = static_cast<short>(32000.0f * std::sin(2.0f * PI * 440.0f * time));
-        }
-        beep = LoadSoundFromWave(wave);
-        UnloadWave(wave);
-        free(wave.data);
+        SetAudioStreamBufferSizeDefault(AudioSynth::BUFFER_SAMPLES);
+        stream = LoadAudioStream(AudioSynth::SAMPLE_RATE, 16, 1);
+        streaming_synth = &synth;
+        SetAudioStreamCallback(stream, fill_stream);
+        PlayAudioStream(stream);
     }
 
     if (IsWindowReady()) {
@@ -67,18 +134,42 @@ bool init_raylib() {
     }
 }
 
-void handle_audio() {
-    static bool was_playing = false;
-    
+void RaylibBackend::shutdown() {
     if (audio_initialized) {
-        if (sound_timer > 0) {
-            if (!was_playing) {
-                PlaySound(beep);
-                was_playing = true;
-            }
-        } else if (was_playing) {
-            StopSound(beep);
-            was_playing = false;
+        UnloadAudioStream(stream);
+        CloseAudioDevice();
+        streaming_synth = nullptr;
+        audio_initialized = false;
+    }
+    if (window_initialized) {
+        UnloadTexture(screen_texture);
+        CloseWindow();
+        window_initialized = false;
+    }
+}
+
+void RaylibBackend::poll_input(Chip8& chip8) {
+    for (const auto& [key, chip8_key] : keymap) {
+        chip8.keypad[chip8_key] = IsKeyDown(key);
+    }
+}
+
+uint16_t RaylibBackend::key_mask() const {
+    uint16_t mask = 0;
+    for (const auto& [key, chip8_key] : keymap) {
+        if (IsKeyDown(key)) {
+            mask |= 1 << chip8_key;
         }
     }
+    return mask;
+}
+
+void RaylibBackend::set_sound(const Chip8& chip8) {
+    if (audio_initialized) {
+        synth.update(chip8);
+    }
+}
+
+bool RaylibBackend::should_quit() {
+    return WindowShouldClose();
 }
@@ -1,27 +1,26 @@
 #include <iostream>
 #include <cstdint>
 #include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <raylib.h>
 #include <filesystem>
+#include <memory>
+#include <random>
 #include <vector>
-#include "chip8.h"
-
-// list rom files!!!
-std::vector<std::string> GetRomFiles(const std::string& romDir) {
-    std::vector<std::string> romFiles;
-    for (const auto& entry : std::filesystem::directory_iterator(romDir)) {
-        if (entry.path().extension() == ".ch8" || entry.path().extension() == ".o8") {
-            romFiles.push_back(entry.path().filename().string());
-        }
-    }
-    return romFiles;
-}
+#include "raylib_backend.h"
+#include "core/debugger.h"
+#include "core/emu_thread.h"
+#include "core/replay.h"
+#include "core/rom_library.h"
+#include "core/trace.h"
+
 // pick from listed rom files!!!
-std::string SelectRom(const std::vector<std::string>& romFiles) {
+std::string SelectRom(const std::vector<RomInfo>& romFiles) {
     std::cout << "Available ROM files:\n";
     for (size_t i = 0; i < romFiles.size(); ++i) {
-        std::cout << i + 1 << ". " << romFiles[i] << "\n";
+        std::cout << i + 1 << ". " << romFiles[i].file << "  (" << platform_name(romFiles[i].platform) << ", "
+                  << romFiles[i].ips << " ips, " << quirks_name(romFiles[i].quirks) << " quirks)\n";
     }
     std::cout << "Enter the number of the ROM you want to load: ";
     size_t choice = 0;
@@ -32,15 +31,107 @@ std::string SelectRom(const std::vector<std::string>& romFiles) {
         return "";
     }
     
-    return romFiles[choice - 1];
+    return romFiles[choice - 1].file;
 }
 
-int main() {
-    srand(time(0));
+constexpr uint32_t IPS_STEP = 100;
+constexpr int DEBUG_PANEL_WIDTH = 400;
+
+// profiler overlay, toggled with F1
+std::string format_hud(const ProfileSummary& summary, const TimeHistogram& present) {
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "%.2f MIPS\n"
+                  "%s %.0f%%  %s %.0f%%  %s %.0f%%\n"
+                  "hot 0x%03X 0x%03X 0x%03X\n"
+                  "emulate p50 %.0f us  p99 %.0f us\n"
+                  "present p50 %.0f us  p99 %.0f us",
+                  summary.ips / 1e6,
+                  op_kind_pattern(summary.top_ops[0]), summary.top_op_share[0] * 100,
+                  op_kind_pattern(summary.top_ops[1]), summary.top_op_share[1] * 100,
+                  op_kind_pattern(summary.top_ops[2]), summary.top_op_share[2] * 100,
+                  summary.hotspots[0].address, summary.hotspots[1].address, summary.hotspots[2].address,
+                  summary.emulate_p50 / 1e3, summary.emulate_p99 / 1e3,
+                  present.percentile(50) / 1e3, present.percentile(99) / 1e3);
+    return text;
+}
+
+int main(int argc, char** argv) {
     std::cerr << "Hello, World!: " << std::endl;
 
+    // [--ips <n>] [--quirks modern|vip|chip48|schip|xochip] [--turbo] [--rewind-mb <n>] [--seed <n>] [--record <file>] [--profile <file>] [--trace <cpu,draw,flow,error|all>] [--trace-level error|info|debug] [--debug] [--break <addr>] [--watch <first>[-<last>][:r|w|rw]]
+    uint32_t ips = 0; // 0 = what the ROM library has for the ROM
+    QuirkProfile quirks = QUIRKS_COUNT; // likewise
+    bool turbo = false;
+    size_t rewind_budget = RewindBuffer::DEFAULT_BUDGET;
+    uint64_t seed = std::random_device{}();
+    std::string record_path;
+    std::string profile_path;
+    uint8_t trace_categories = 0;
+    TraceLevel trace_level = TRACE_LEVEL_DEBUG;
+    // --debug starts paused; --break/--watch attach the debugger too
+    Debugger debugger;
+    bool debugging = false;
+    bool start_paused = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--turbo") {
+            turbo = true;
+        } else if (arg == "--ips" && i + 1 < argc) {
+            ips = std::stoul(argv[++i]);
+        } else if (arg == "--quirks" && i + 1 < argc) {
+            if (!parse_quirks(argv[++i], quirks)) {
+                return 1;
+            }
+        } else if (arg == "--rewind-mb" && i + 1 < argc) {
+            rewind_budget = std::stoul(argv[++i]) << 20;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_categories = parse_trace_categories(argv[++i]);
+            if (!trace_categories) {
+                return 1;
+            }
+        } else if (arg == "--trace-level" && i + 1 < argc) {
+            if (!parse_trace_level(argv[++i], trace_level)) {
+                return 1;
+            }
+        } else if (arg == "--debug") {
+            debugging = true;
+            start_paused = true;
+        } else if (arg == "--break" && i + 1 < argc) {
+            uint16_t address;
+            if (!parse_debug_address(argv[++i], address)) {
+                return 1;
+            }
+            debugger.set_breakpoint(address);
+            debugging = true;
+        } else if (arg == "--watch" && i + 1 < argc) {
+            Watchpoint watch;
+            if (!parse_watchpoint(argv[++i], watch)) {
+                return 1;
+            }
+            debugger.add_watchpoint(watch);
+            debugging = true;
+        } else {
+            std::cerr << "Unknown option > " << arg << std::endl;
+            return 1;
+        }
+    }
+
     const std::string romDirectory = "../../ROMs";
-    std::vector<std::string> romFiles = GetRomFiles(romDirectory);
+    RomLibrary library(romDirectory);
+    if (!library.refresh()) {
+        return 1;
+    }
+    if (library.analysed()) {
+        library.save();
+    }
+    const std::vector<RomInfo>& romFiles = library.roms();
 
     if (romFiles.empty()) {
         std::cerr << "No ROM files found in the directory.\n";
@@ -54,58 +145,167 @@ int main() {
         return 1;
     }
 
-    const std::string filepath = romDirectory + "/" + selectedRom;
-    std::cerr << "ROM found: " << filepath << std::endl;
+    RomInfo& rom = *library.find(selectedRom);
+    const std::string filepath = library.path(rom);
+    std::cerr << "ROM found: " << filepath << " (" << platform_name(rom.platform) << ")" << std::endl;
+    if (ips == 0) {
+        ips = rom.ips ? rom.ips : Scheduler::DEFAULT_IPS;
+    }
+    if (quirks == QUIRKS_COUNT) {
+        quirks = rom.quirks;
+    }
     std::cerr << "Loading ROM...: " << std::endl;
-    std::cerr << "Logging in debuglog.txt" << std::endl;
-    freopen("debuglog.txt", "w", stdout);
     SetTraceLogLevel(LOG_INFO);
 
-    initialize_system();
+    Chip8 chip8;
+    chip8.seed_random(seed);
+    chip8.quirks = quirks;
+    chip8.initialize_system();
 
-    if (!init_raylib()) {
-        return 1;
+    Tracer tracer;
+    if (trace_categories) {
+        std::cerr << "Tracing to trace.bin" << std::endl;
+        if (!tracer.start("trace.bin")) {
+            return 1;
+        }
+        tracer.enable(trace_categories, trace_level);
+        chip8.tracer = &tracer;
     }
 
-    if (!load_chip8_file(filepath)) {
-        CloseWindow();
-        if (audio_initialized) {
-            UnloadSound(beep);
-            CloseAudioDevice();
-        }
+    RaylibBackend backend;
+    if (!backend.init_raylib(debugging ? DEBUG_PANEL_WIDTH : 0)) {
         return 1;
     }
 
-    bool quit = false;
-    constexpr auto frame_delay = std::chrono::microseconds(16667);
-    auto last_frame_time = std::chrono::high_resolution_clock::now();
+    if (!chip8.load_chip8_file(filepath)) {
+        backend.shutdown();
+        return 1;
+    }
+    // built with this ROM's chip8_aot output linked in: run that
+    if (const AotProgram* program = find_aot_program(hash_rom(chip8), chip8.quirks)) {
+        std::cerr << "Running compiled blocks for " << program->name << std::endl;
+        chip8.set_aot(program);
+    }
 
-    while (!quit && !WindowShouldClose()) {
-        auto current_time = std::chrono::high_resolution_clock::now();
-        auto elapsed = current_time - last_frame_time;
+    // Recording starts from this reset state. Rewind and state loading would
+    // cut the log loose from the machine, so they're off while it runs.
+    const bool recording = !record_path.empty();
+    Recorder recorder;
+    if (recording) {
+        std::cerr << "Recording to " << record_path << " with seed " << seed << std::endl;
+        recorder.begin(chip8);
+        chip8.recorder = &recorder;
+    }
 
-        process_input();
+    // Emulation runs on its own thread from here on; this thread only
+    // forwards keys, draws the newest finished screen and drives the beeper.
+    // EndDrawing() waits for the 60 FPS target, but that no longer holds up
+    // the CPU.
+    // Page Up/Down change the speed, holding Tab fast-forwards, holding
+    // Backspace rewinds, F5/F9 save/load the state next to the ROM, F1
+    // toggles the profiler overlay.
+    // the profiler keeps the machine on the (instrumented) interpreter
+    std::unique_ptr<Profiler> profiler;
+    bool show_hud = false;
+    if (!profile_path.empty()) {
+        profiler = std::make_unique<Profiler>();
+        chip8.profiler = profiler.get();
+        show_hud = true;
+    }
 
-        // opcode exec
-        for (int i = 0; i < 10; i++) {
-            uint16_t opcode = grab_opcode();
-            run_opcode(opcode);
+    // With the debugger attached the machine runs on the interpreter, one
+    // instruction at a time, and a side panel shows registers, stack and a
+    // listing around pc. F6 pauses/continues, F7 steps, F8 steps over a
+    // 2NNN call, Shift+F8 steps out of the current one; Up/Down move the
+    // listing cursor and F2 toggles a breakpoint there.
+    size_t debug_cursor = DebugView::LINES_BEFORE_PC;
+    if (debugging) {
+        if (start_paused) {
+            debugger.pause();
         }
+        chip8.debugger = &debugger;
+    }
 
-        update_timers();
-        handle_audio();
-
-        if (elapsed >= frame_delay) {
-            render_screen();
-            last_frame_time = current_time;
+    EmulationThread emulation(chip8, ips);
+    emulation.set_state_path(filepath + ".state");
+    emulation.set_rewind(recording ? 0 : rewind_budget, 1);
+    emulation.set_audio(backend.audio());
+    emulation.start();
+    LatencyStats latency;
+    while (!backend.should_quit()) {
+        emulation.set_keys(backend.key_mask());
+        if (IsKeyPressed(KEY_PAGE_UP)) {
+            emulation.set_ips(emulation.ips() + IPS_STEP);
+            std::cerr << "Speed: " << emulation.ips() << " instructions/s" << std::endl;
+        } else if (IsKeyPressed(KEY_PAGE_DOWN) && emulation.ips() > IPS_STEP) {
+            emulation.set_ips(emulation.ips() - IPS_STEP);
+            std::cerr << "Speed: " << emulation.ips() << " instructions/s" << std::endl;
+        }
+        emulation.set_turbo(turbo || IsKeyDown(KEY_TAB));
+        emulation.set_rewinding(IsKeyDown(KEY_BACKSPACE));
+        if (IsKeyPressed(KEY_F5)) {
+            emulation.request_save();
+        } else if (IsKeyPressed(KEY_F9) && !recording) {
+            emulation.request_load();
+        }
+        const bool fresh = emulation.poll_frame();
+        const EmuFrame& frame = emulation.frame();
+        if (profiler && IsKeyPressed(KEY_F1)) {
+            show_hud = !show_hud;
+        }
+        const DebugView* debug_view = nullptr;
+        if (debugging) {
+            debug_view = &emulation.debug_view();
+            const bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+            if (IsKeyPressed(KEY_F6)) {
+                emulation.request_debug(debug_view->stop == DEBUG_RUNNING ? EmulationThread::DEBUG_COMMAND_PAUSE
+                                                                          : EmulationThread::DEBUG_COMMAND_CONTINUE);
+            } else if (IsKeyPressed(KEY_F7)) {
+                emulation.request_debug(EmulationThread::DEBUG_COMMAND_STEP);
+            } else if (IsKeyPressed(KEY_F8)) {
+                emulation.request_debug(shift ? EmulationThread::DEBUG_COMMAND_STEP_OUT
+                                              : EmulationThread::DEBUG_COMMAND_STEP_OVER);
+            } else if (IsKeyPressed(KEY_F2)) {
+                emulation.request_debug(EmulationThread::DEBUG_COMMAND_TOGGLE_BREAKPOINT,
+                                        debug_view->listing[debug_cursor].address);
+            }
+            if (IsKeyPressed(KEY_UP) && debug_cursor > 0) {
+                --debug_cursor;
+            } else if (IsKeyPressed(KEY_DOWN) && debug_cursor + 1 < DebugView::LISTING_LINES) {
+                ++debug_cursor;
+            }
+        }
+        backend.draw(frame.screen, show_hud ? format_hud(emulation.profile_summary(), profiler->present) : std::string(),
+                     debug_view, debug_cursor);
+        if (profiler) {
+            profiler->present.record(backend.last_draw_ns);
+        }
+        if (fresh && frame.drawn_at) {
+            latency.record(steady_now_ns() - frame.drawn_at);
         }
     }
+    emulation.stop();
+    // a speed picked with Page Up/Down sticks to the ROM
+    if (emulation.ips() != ips) {
+        rom.ips = emulation.ips();
+        library.save();
+    }
 
-    if (audio_initialized) {
-        UnloadSound(beep);
-        CloseAudioDevice();
+    if (recording && recorder.finish(chip8, record_path)) {
+        std::cerr << "Replay written, " << recorder.event_bytes() << " bytes of input" << std::endl;
+    }
+    if (profiler && profiler->write_report(chip8, profile_path)) {
+        std::cerr << "Profile written to " << profile_path << std::endl;
+    }
+    if (latency.samples) {
+        std::cerr << "DXYN to screen latency over " << latency.samples << " frames: mean "
+                  << latency.mean_ms() << " ms, max " << latency.max_ms() << " ms" << std::endl;
+    }
+    backend.shutdown();
+    tracer.stop();
+    if (tracer.dropped()) {
+        std::cerr << tracer.dropped() << " trace records dropped" << std::endl;
     }
-    CloseWindow();
     std::cerr << "Goodbye, World..." << std::endl;
     return 0;
 }
@@ -0,0 +1,53 @@
+#ifndef RAYLIB_BACKEND_H
+#define RAYLIB_BACKEND_H
+#include "core/audio.h"
+#include "core/backend.h"
+#include "core/debugger.h"
+#include <map>
+#include <string>
+#include <raylib.h>
+
+// Window, keyboard and beeper through raylib.
+class RaylibBackend : public Backend {
+public:
+    // `panel_width` pixels to the right of the screen are kept for the
+    // debugger panel
+    bool init_raylib(int panel_width = 0);
+    void shutdown();
+
+    void poll_input(Chip8& chip8) override;
+    void present(const Chip8& chip8) override;
+    void set_sound(const Chip8& chip8) override;
+    bool should_quit() override;
+
+    // same as present()/poll_input() but without a Chip8, for a renderer
+    // fed by an EmulationThread; `overlay` is drawn as text over the screen,
+    // `debug` in the side panel with line `cursor` of its listing marked
+    void draw(const Framebuffer& screen, const std::string& overlay = {},
+              const DebugView* debug = nullptr, size_t cursor = 0);
+    uint16_t key_mask() const;
+    // what the audio stream plays from, for an EmulationThread to feed;
+    // null if there is no audio device
+    AudioSynth* audio() { return audio_initialized ? &synth : nullptr; }
+
+    // CPU time of the last draw() up to the buffer swap, vsync wait excluded
+    int64_t last_draw_ns = 0;
+
+private:
+    void draw_debug_panel(const DebugView& view, size_t cursor);
+
+    bool window_initialized = false;
+    int panel_width = 0;
+    bool audio_initialized = false;
+    AudioSynth synth;
+    AudioStream stream{};
+
+    Texture2D screen_texture{};
+    std::array<Color, SWIDTH * SHEIGHT> pixels{};
+    Framebuffer last_uploaded{};
+    bool uploaded = false;
+};
+
+extern const std::map<int, uint8_t> keymap;
+
+#endif // RAYLIB_BACKEND_H
@@ -0,0 +1,482 @@
+// Ahead-of-time compiler: turns a ROM into C++ with one function per basic
+// block, to be compiled and linked in next to the core.
+//   chip8_aot [--quirks <profile>] <rom> <out.cpp>
+//
+// Code is found by following control flow from PROGRAM_START, so it only
+// covers what can be seen statically: BNNN targets are unknown (apart from
+// a jump table of 1NNN right at NNN), and so is anything that only ever
+// runs after being written at runtime. That code runs through the
+// interpreter; see core/aot.h for how the two hand over. Most ops become
+// inline C++; DXYN calls Chip8::draw_sprite() and FX0A, FX33, FX55 and 5XY2
+// go through Chip8::run_opcode(). The quirk profile (modern unless given) is
+// compiled in; the program is only used by machines running that profile.
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/chip8.h"
+#include "core/replay.h"
+
+namespace {
+
+// same limit as the recompiler, so a block fits a small batch
+constexpr size_t MAX_BLOCK_OPS = 32;
+
+struct Rom {
+    Chip8 machine;
+    size_t size = 0;
+
+    // in the ROM, and short of where pc wraps under the machine's profile
+    bool contains(uint32_t address) const {
+        return address >= PROGRAM_START && address + 2 <= PROGRAM_START + size && address + 2 <= machine.code_size();
+    }
+    uint16_t opcode(uint16_t address) const {
+        return (machine.memory[address] << 8) | machine.memory[address + 1];
+    }
+    DecodedOp op(uint16_t address) const { return decode_opcode(opcode(address)); }
+};
+
+// stores that may rewrite code, this block's included
+bool stores(OpKind kind) {
+    return kind == OP_LD_B_VX || kind == OP_LD_MEM_VX || kind == OP_SAVE_RANGE;
+}
+
+bool is_skip(OpKind kind) {
+    switch (kind) {
+        case OP_SE_VX_NN: case OP_SNE_VX_NN: case OP_SE_VX_VY: case OP_SNE_VX_VY: case OP_SKP: case OP_SKNP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// After a store the runtime has to check the next block is still intact.
+bool ends_block(OpKind kind) {
+    return kind == OP_JP || kind == OP_CALL || kind == OP_RET || kind == OP_JP_V0 || kind == OP_LD_VX_K ||
+           kind == OP_LD_I_LONG || kind == OP_EXIT || is_skip(kind) || stores(kind);
+}
+
+struct Cfg {
+    std::vector<uint8_t> reached = std::vector<uint8_t>(MEM_SIZE);  // an instruction starts here
+    std::vector<uint8_t> leader = std::vector<uint8_t>(MEM_SIZE);   // a block has to start here
+    std::vector<uint16_t> indirect;                                 // BNNN sites
+};
+
+Cfg trace_control_flow(const Rom& rom, const Quirks& quirks) {
+    Cfg cfg;
+    std::vector<uint16_t> work;
+    const auto branch = [&](uint32_t target) {
+        if (rom.contains(target)) {
+            cfg.leader[target] = 1;
+            work.push_back(target);
+        }
+    };
+    branch(PROGRAM_START);
+
+    while (!work.empty()) {
+        const uint16_t at = work.back();
+        work.pop_back();
+        if (cfg.reached[at]) {
+            continue;
+        }
+        cfg.reached[at] = 1;
+        const DecodedOp op = rom.op(at);
+        const uint16_t next = at + 2;
+        if (op.kind == OP_JP) {
+            branch(op.nnn);
+        } else if (op.kind == OP_CALL) {
+            branch(op.nnn);
+            branch(next); // where 00EE comes back to
+        } else if (op.kind == OP_RET) {
+            // target is on the stack; every return address is a leader already
+        } else if (op.kind == OP_JP_V0) {
+            cfg.indirect.push_back(at);
+            for (uint32_t entry = op.nnn; rom.contains(entry) && (rom.opcode(entry) & 0xF000) == 0x1000; entry += 2) {
+                branch(entry);
+            }
+        } else if (is_skip(op.kind)) {
+            branch(next);
+            // over F000 NNNN the skip lands past the address word
+            const bool long_skip = quirks.long_skips && rom.contains(next) && rom.op(next).kind == OP_LD_I_LONG;
+            branch(long_skip ? next + 4 : next + 2);
+        } else if (op.kind == OP_LD_VX_K) {
+            cfg.leader[at] = 1; // comes back here until a key is down
+            branch(next);
+        } else if (op.kind == OP_EXIT) {
+            cfg.leader[at] = 1; // stays here for good
+        } else if (op.kind == OP_LD_I_LONG) {
+            branch(next + 2); // past the address word
+        } else if (stores(op.kind)) {
+            branch(next);
+        } else if (rom.contains(next)) {
+            work.push_back(next);
+        }
+    }
+    return cfg;
+}
+
+struct Block {
+    uint16_t address;
+    std::vector<uint16_t> ops; // addresses
+};
+
+// Splits the reached code into blocks at every leader. Blocks never overlap
+// (code read at two alignments keeps the first block), so a write can only
+// ever hit one.
+std::vector<Block> form_blocks(const Rom& rom, Cfg& cfg) {
+    std::vector<Block> blocks;
+    std::vector<uint8_t> covered(MEM_SIZE);
+    for (uint32_t start = PROGRAM_START; start < PROGRAM_START + rom.size; ++start) {
+        if (!cfg.leader[start] || !cfg.reached[start]) {
+            continue;
+        }
+        Block block{static_cast<uint16_t>(start), {}};
+        for (uint16_t at = start;; at += 2) {
+            block.ops.push_back(at);
+            const uint16_t next = at + 2;
+            if (ends_block(rom.op(at).kind) || !rom.contains(next)) {
+                break;
+            }
+            if (block.ops.size() == MAX_BLOCK_OPS) {
+                cfg.leader[next] = 1; // carry on in a block of its own
+                break;
+            }
+            if (cfg.leader[next]) {
+                break;
+            }
+        }
+        const uint32_t end = start + 2 * block.ops.size();
+        bool overlaps = false;
+        for (uint32_t byte = start; byte < end; ++byte) {
+            overlaps |= covered[byte] != 0;
+        }
+        if (overlaps) {
+            continue;
+        }
+        std::fill(covered.begin() + start, covered.begin() + end, 1);
+        blocks.push_back(std::move(block));
+    }
+    return blocks;
+}
+
+std::string hex(unsigned value) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%03X", value);
+    return text;
+}
+
+std::string hex_byte(unsigned value) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%02X", value);
+    return text;
+}
+
+std::string vreg(unsigned index) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "c.v_regs[0x%X]", index);
+    return text;
+}
+
+// C++ for one op, matching its interpreter handler under `quirks`. Returns
+// true if it ended in a return (control flow ops always do).
+bool emit_op(std::ostream& out, const DecodedOp& op, uint16_t opcode, uint16_t at, const Quirks& quirks) {
+    const std::string vx = vreg(op.x), vy = vreg(op.y), vf = vreg(0xF);
+    const std::string shifted = quirks.shift_vx ? vx : vy;
+    const std::string reset_vf = quirks.logic_resets_vf ? "    " + vf + " = 0;\n" : "";
+    const std::string next = hex(at + 2), nn = hex_byte(op.nn);
+    // over F000 NNNN the skip is four bytes, and which it is can only be
+    // seen when it runs
+    const std::string skip = quirks.long_skips ? "(c.memory[" + hex(at + 2) + "] == 0xF0 && c.memory[" +
+                                                     hex(at + 3) + "] == 0x00 ? " + hex(at + 6) + " : " +
+                                                     hex(at + 4) + ")"
+                                               : hex(at + 4);
+    switch (op.kind) {
+        case OP_CLS:
+            out << "    c.clear_screen();\n";
+            return false;
+        case OP_SCD:
+            out << "    c.scroll_down(" << int(op.n) << ");\n";
+            return false;
+        case OP_SCU:
+            out << "    c.scroll_up(" << int(op.n) << ");\n";
+            return false;
+        case OP_SCR:
+            out << "    c.scroll_right();\n";
+            return false;
+        case OP_SCL:
+            out << "    c.scroll_left();\n";
+            return false;
+        case OP_EXIT:
+            out << "    return " << hex(at) << ";\n";
+            return true;
+        case OP_LOW:
+        case OP_HIGH:
+            out << "    c.set_hires(" << (op.kind == OP_HIGH ? "true" : "false") << ");\n";
+            return false;
+        case OP_LOAD_RANGE: {
+            const int step = op.x <= op.y ? 1 : -1;
+            for (int r = op.x, k = 0;; r += step, ++k) {
+                out << "    " << vreg(r) << " = c.memory[c.i_reg + " << k << "];\n";
+                if (r == op.y) {
+                    break;
+                }
+            }
+            return false;
+        }
+        case OP_LD_I_LONG:
+            out << "    c.i_reg = (c.memory[" << hex(at + 2) << "] << 8) | c.memory[" << hex(at + 3) << "];\n"
+                << "    return " << hex(at + 4) << ";\n";
+            return true;
+        case OP_PLANE:
+            out << "    c.planes = " << (op.x & ((1 << NUM_PLANES) - 1)) << ";\n";
+            return false;
+        case OP_LD_HF_VX:
+            out << "    c.i_reg = BIG_FONTSET_START_ADDRESS + (" << vx << " & 0xF) * 10;\n";
+            return false;
+        case OP_SAVE_FLAGS:
+        case OP_LOAD_FLAGS: {
+            const bool save = op.kind == OP_SAVE_FLAGS;
+            out << "    std::copy_n(c." << (save ? "v_regs" : "rpl_flags") << ".begin(), " << op.x + 1 << ", c."
+                << (save ? "rpl_flags" : "v_regs") << ".begin());\n";
+            return false;
+        }
+        case OP_RET:
+            out << "    if (c.sp > 0) {\n        return c.stack[--c.sp];\n    }\n    return " << next << ";\n";
+            return true;
+        case OP_JP:
+            out << "    return " << hex(op.nnn) << ";\n";
+            return true;
+        case OP_CALL:
+            out << "    if (c.sp >= STACK_SIZE) {\n        return " << next << ";\n    }\n"
+                << "    c.stack[c.sp++] = " << next << ";\n    return " << hex(op.nnn) << ";\n";
+            return true;
+        case OP_SE_VX_NN:
+            out << "    return " << vx << " == " << nn << " ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_SNE_VX_NN:
+            out << "    return " << vx << " != " << nn << " ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_SE_VX_VY:
+            out << "    return " << vx << " == " << vy << " ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_SNE_VX_VY:
+            out << "    return " << vx << " != " << vy << " ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_SKP:
+            out << "    return c.keypad[" << vx << " & 0xF] ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_SKNP:
+            out << "    return !c.keypad[" << vx << " & 0xF] ? " << skip << " : " << next << ";\n";
+            return true;
+        case OP_LD_VX_NN:
+            out << "    " << vx << " = " << nn << ";\n";
+            return false;
+        case OP_ADD_VX_NN:
+            out << "    " << vx << " += " << nn << ";\n";
+            return false;
+        case OP_LD_VX_VY:
+            out << "    " << vx << " = " << vy << ";\n";
+            return false;
+        case OP_OR_VX_VY:
+            out << "    " << vx << " |= " << vy << ";\n" << reset_vf;
+            return false;
+        case OP_AND_VX_VY:
+            out << "    " << vx << " &= " << vy << ";\n" << reset_vf;
+            return false;
+        case OP_XOR_VX_VY:
+            out << "    " << vx << " ^= " << vy << ";\n" << reset_vf;
+            return false;
+        case OP_ADD_VX_VY:
+            out << "    {\n        const uint16_t result = " << vx << " + " << vy << ";\n"
+                << "        " << vx << " = static_cast<uint8_t>(result);\n"
+                << "        " << vf << " = result > 0xFF;\n    }\n";
+            return false;
+        case OP_SUB:
+        case OP_SUBN: {
+            const bool subn = op.kind == OP_SUBN;
+            out << "    {\n        const uint8_t vx = " << vx << ", vy = " << vy << ";\n"
+                << "        " << vx << " = " << (subn ? "vy - vx" : "vx - vy") << ";\n"
+                << "        " << vf << " = " << (subn ? "vy >= vx" : "vx >= vy") << ";\n    }\n";
+            return false;
+        }
+        case OP_SHR:
+            out << "    {\n        const uint8_t value = " << shifted << ";\n"
+                << "        " << vx << " = value >> 1;\n        " << vf << " = value & 0x1;\n    }\n";
+            return false;
+        case OP_SHL:
+            out << "    {\n        const uint8_t value = " << shifted << ";\n"
+                << "        " << vx << " = value << 1;\n        " << vf << " = value >> 7;\n    }\n";
+            return false;
+        case OP_LD_I:
+            out << "    c.i_reg = " << hex(op.nnn) << ";\n";
+            return false;
+        case OP_RND:
+            out << "    " << vx << " = c.next_random() & " << nn << ";\n";
+            return false;
+        case OP_LD_VX_DT:
+            out << "    " << vx << " = c.delay_timer;\n";
+            return false;
+        case OP_LD_DT_VX:
+            out << "    c.delay_timer = " << vx << ";\n";
+            return false;
+        case OP_LD_ST_VX:
+            out << "    c.sound_timer = " << vx << ";\n";
+            return false;
+        case OP_ADD_I_VX:
+            out << "    c.i_reg += " << vx << ";\n";
+            if (quirks.index_overflow_vf) {
+                out << "    " << vf << " = c.i_reg > 0xFFF;\n";
+            }
+            return false;
+        case OP_LD_F_VX:
+            out << "    c.i_reg = FONTSET_START_ADDRESS + " << vx << " * 5;\n";
+            return false;
+        case OP_LD_VX_MEM:
+            out << "    for (int i = 0; i <= " << int(op.x) << "; ++i) {\n"
+                << "        c.v_regs[i] = c.memory[(c.i_reg + i) & (MEM_SIZE - 1)];\n    }\n";
+            if (quirks.index_after_store != INDEX_UNCHANGED) {
+                out << "    c.i_reg += " << (quirks.index_after_store == INDEX_PAST_LAST ? op.x + 1 : op.x) << ";\n";
+            }
+            return false;
+        case OP_AUDIO:
+            out << "    for (size_t i = 0; i < AUDIO_PATTERN_SIZE; ++i) {\n"
+                << "        c.audio_pattern[i] = c.memory[(c.i_reg + i) & (MEM_SIZE - 1)];\n    }\n";
+            return false;
+        case OP_LD_PITCH_VX:
+            out << "    c.pitch = " << vx << ";\n";
+            return false;
+        case OP_JP_V0:
+            out << "    return " << hex(op.nnn) << " + " << vreg(quirks.jump_vx ? op.x : 0) << ";\n";
+            return true;
+        case OP_DRW:
+            out << "    c.draw_sprite(" << vx << ", " << vy << ", " << int(op.n) << ");\n";
+            return false;
+        case OP_LD_VX_K:
+        case OP_LD_B_VX:
+        case OP_LD_MEM_VX:
+        case OP_SAVE_RANGE: {
+            // handlers expect pc already past the op; FX0A moves it back
+            char call[64];
+            std::snprintf(call, sizeof(call), "    c.pc = %s;\n    c.run_opcode(0x%04X);\n", next.c_str(), opcode);
+            out << call << "    return " << (op.kind == OP_LD_VX_K ? std::string("c.pc") : next) << ";\n";
+            return true;
+        }
+        default:
+            return false; // 0NNN and unknown opcodes do nothing
+    }
+}
+
+bool write_program(const Rom& rom, const std::string& rom_name, const std::vector<Block>& blocks,
+                   size_t reached, QuirkProfile quirks, const std::string& filepath) {
+    std::ofstream out(filepath);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    size_t compiled = 0;
+    for (const Block& block : blocks) {
+        compiled += block.ops.size();
+    }
+    out << "// Generated by chip8_aot from " << rom_name << ", do not edit.\n"
+        << "// " << blocks.size() << " blocks, " << compiled << " of " << reached << " reachable instructions, "
+        << quirks_name(quirks) << " quirks.\n"
+        << "#include <algorithm>\n#include <iterator>\n#include \"core/chip8.h\"\n\nnamespace {\n";
+
+    for (const Block& block : blocks) {
+        out << "\ninline uint16_t block_" << std::hex << block.address << std::dec << "([[maybe_unused]] Chip8& c) {\n";
+        bool returned = false;
+        for (uint16_t at : block.ops) {
+            out << "    // " << hex(at) << "  " << disassemble(rom.opcode(at)) << "\n";
+            returned = emit_op(out, rom.op(at), rom.opcode(at), at, QUIRK_PROFILES[quirks]);
+        }
+        if (!returned) {
+            out << "    return " << hex(block.ops.back() + 2) << ";\n";
+        }
+        out << "}\n";
+    }
+
+    // one switch over all blocks, so each block function is inlined into it
+    // and going from one block to the next is a single indirect jump
+    out << "\nint run(Chip8& c, int budget, const AotBlock* const* live) {\n"
+        << "    uint16_t pc = c.pc;\n"
+        << "    for (;;) {\n"
+        << "        const AotBlock* block = live[pc & " << hex(static_cast<unsigned>(code_size_for(QUIRK_PROFILES[quirks]) - 1)) << "];\n"
+        << "        if (!block || block->address != pc || block->length > budget) {\n"
+        << "            break;\n        }\n"
+        << "        budget -= block->length;\n"
+        << "        switch (pc) {\n";
+    for (const Block& block : blocks) {
+        out << "            case " << hex(block.address) << ": pc = block_" << std::hex << block.address << std::dec
+            << "(c); break;\n";
+    }
+    out << "        }\n    }\n    c.pc = pc;\n    return budget;\n}\n";
+
+    out << "\nconst uint8_t image[] = {";
+    for (size_t i = 0; i < rom.size; ++i) {
+        out << (i % 16 ? " " : "\n    ") << hex_byte(rom.machine.memory[PROGRAM_START + i]) << ',';
+    }
+    out << "\n};\n\nconst AotBlock blocks[] = {\n";
+    for (const Block& block : blocks) {
+        out << "    {" << hex(block.address) << ", " << block.ops.size() << "},\n";
+    }
+    char hash[32];
+    std::snprintf(hash, sizeof(hash), "0x%016llXULL", static_cast<unsigned long long>(hash_rom(rom.machine)));
+    out << "};\n\nconst AotProgram program = {\"" << rom_name << "\", " << hash
+        << ", image, sizeof(image), blocks, std::size(blocks), run, static_cast<QuirkProfile>(" << int(quirks)
+        << ")};\n"
+        << "[[maybe_unused]] const bool registered = register_aot_program(program);\n\n} // namespace\n";
+    return out.good();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QuirkProfile quirks = QUIRKS_MODERN;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--quirks" && i + 1 < argc) {
+            if (!parse_quirks(argv[++i], quirks)) {
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() != 2) {
+        std::cerr << "usage: " << argv[0] << " [--quirks modern|vip|chip48|schip|xochip] <rom> <out.cpp>\n";
+        return 1;
+    }
+    const std::string filepath = args[0];
+
+    Rom rom;
+    rom.machine.quirks = quirks;
+    rom.machine.initialize_system();
+    if (!rom.machine.load_chip8_file(filepath)) {
+        return 1;
+    }
+    rom.size = std::filesystem::file_size(filepath);
+
+    Cfg cfg = trace_control_flow(rom, QUIRK_PROFILES[quirks]);
+    const std::vector<Block> blocks = form_blocks(rom, cfg);
+    if (blocks.empty()) {
+        std::cerr << "Nothing to compile in " << filepath << std::endl;
+        return 1;
+    }
+    size_t reached = 0;
+    for (uint8_t r : cfg.reached) {
+        reached += r;
+    }
+    const std::string rom_name = std::filesystem::path(filepath).filename().string();
+    if (!write_program(rom, rom_name, blocks, reached, quirks, args[1])) {
+        return 1;
+    }
+
+    std::cerr << blocks.size() << " blocks written to " << args[1] << std::endl;
+    for (uint16_t at : cfg.indirect) {
+        std::cerr << "  " << hex(at) << "  " << disassemble(rom.opcode(at)) << ": targets interpreted\n";
+    }
+    return 0;
+}
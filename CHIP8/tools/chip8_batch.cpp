@@ -0,0 +1,156 @@
+// Runs many copies of one ROM side by side through the batch engine, each
+// with its own CXNN seed (and, with --random-keys, its own key presses),
+// and reports the aggregate speed.
+//   chip8_batch [options] <rom>
+//
+// Lanes get seeds seed, seed + 1, ... and run the way chip8_headless runs
+// a ROM at its default speed: ips/60 instructions, then a timer tick.
+// --check also runs every lane as an ordinary machine and compares the
+// final states.
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/batch.h"
+#include "core/savestate.h"
+#include "core/scheduler.h"
+
+namespace {
+
+const char* USAGE =
+    " [options] <rom>\n"
+    "  --lanes <n>               machines to run (default 256)\n"
+    "  --cycles <n>              instructions per machine (default 1000000)\n"
+    "  --ips <n>                 instructions per 60 Hz timer tick * 60 (default 600)\n"
+    "  --seed <n>                CXNN seed of the first lane\n"
+    "  --quirks <profile>        modern (default), vip, chip48, schip or xochip\n"
+    "  --random-keys             every lane presses keys of its own each frame\n"
+    "  --check                   run every lane as an ordinary machine too and compare\n";
+
+// a different, repeatable key mask per lane and frame (splitmix64); mostly
+// nothing pressed, so ROMs get to see key releases too
+uint16_t random_keys(uint64_t lane, uint64_t frame) {
+    uint64_t z = (lane << 32 | frame) + 0x9E3779B97F4A7C15;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    z ^= z >> 31;
+    return (z & 3) ? 0 : static_cast<uint16_t>(1u << ((z >> 2) & 0xF));
+}
+
+void set_keys(Chip8& chip8, uint16_t keys) {
+    for (size_t key = 0; key < NUM_KEYS; ++key) {
+        chip8.keypad[key] = (keys >> key) & 1;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t lanes = 256;
+    uint64_t cycles = 1000000;
+    uint32_t ips = Scheduler::DEFAULT_IPS;
+    uint64_t seed = DEFAULT_RNG_SEED;
+    QuirkProfile quirks = QUIRKS_MODERN;
+    bool keys = false;
+    bool check = false;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--lanes" && i + 1 < argc) {
+            lanes = std::stoul(argv[++i]);
+        } else if (arg == "--cycles" && i + 1 < argc) {
+            cycles = std::stoull(argv[++i]);
+        } else if (arg == "--ips" && i + 1 < argc) {
+            ips = std::stoul(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--quirks" && i + 1 < argc) {
+            if (!parse_quirks(argv[++i], quirks)) {
+                return 1;
+            }
+        } else if (arg == "--random-keys") {
+            keys = true;
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg.starts_with("--")) {
+            std::cerr << "usage: " << argv[0] << USAGE;
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() != 1 || lanes == 0 || ips < 60) {
+        std::cerr << "usage: " << argv[0] << USAGE;
+        return 1;
+    }
+    if (!Batch::simd_available()) {
+        std::cerr << "No AVX2 on this host, every lane runs on its own.\n";
+    }
+
+    Chip8 prototype;
+    prototype.quirks = quirks;
+    prototype.initialize_system();
+    if (!prototype.load_chip8_file(args[0])) {
+        return 1;
+    }
+    const auto created = std::chrono::steady_clock::now();
+    Batch batch(prototype, lanes);
+    const double setup = std::chrono::duration<double>(std::chrono::steady_clock::now() - created).count();
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        batch.seed_random(lane, seed + lane);
+    }
+
+    const int per_frame = static_cast<int>(ips / 60);
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t done = 0, frame = 0; done < cycles; ++frame) {
+        if (keys) {
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                batch.set_keys(lane, random_keys(lane, frame));
+            }
+        }
+        const int count = static_cast<int>(std::min<uint64_t>(per_frame, cycles - done));
+        batch.run(count);
+        batch.update_timers();
+        done += count;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%zu lanes x %llu instructions in %.3f s: %.1f MIPS aggregate, %.1f%% in lockstep\n", lanes,
+                static_cast<unsigned long long>(cycles), seconds, batch.instructions() / seconds / 1e6,
+                100.0 * batch.lockstep_instructions() / batch.instructions());
+    // lanes start out sharing every page with the prototype
+    size_t private_pages = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        private_pages += batch.lane(lane).memory.private_pages();
+    }
+    std::printf("set up in %.3f ms; %zu pages (%zu KB) written to across lanes, %.2f per lane\n", setup * 1e3,
+                private_pages, private_pages * MEMORY_PAGE_SIZE / 1024, static_cast<double>(private_pages) / lanes);
+
+    if (!check) {
+        return 0;
+    }
+    size_t mismatches = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        Chip8 chip8;
+        chip8.quirks = quirks;
+        chip8.initialize_system();
+        chip8.load_chip8_file(args[0]);
+        chip8.seed_random(seed + lane);
+        for (uint64_t done = 0, frame = 0; done < cycles; ++frame) {
+            if (keys) {
+                set_keys(chip8, random_keys(lane, frame));
+            }
+            const int count = static_cast<int>(std::min<uint64_t>(per_frame, cycles - done));
+            chip8.interpret(count);
+            chip8.update_timers();
+            done += count;
+        }
+        if (hash_state(chip8) != hash_state(batch.lane(lane))) {
+            std::printf("lane %zu differs from running on its own\n", lane);
+            ++mismatches;
+        }
+    }
+    std::printf("%zu of %zu lanes match running on their own\n", lanes - mismatches, lanes);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+// Core throughput benchmarks, printed as JSON.
+//   chip8_bench [--mode interp|jit|both] [--cycles <n>] [--repeat <n>] [--no-idle-skip] [--no-fuse] [rom...]
+//
+// Synthetic kernels exercise one opcode family each in a tight loop and
+// call Chip8::run() directly, so they measure the dispatch and the handlers
+// and nothing else. ROMs run through the turbo scheduler and a headless
+// backend, like chip8_headless, so timers and presentation are included.
+// Busy-wait loops in ROMs are skipped as usual unless --no-idle-skip is
+// given, which is the flag to use when comparing interpreter speed.
+// --no-fuse turns superinstructions off, to see what they're worth.
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/headless.h"
+#include "core/scheduler.h"
+
+namespace {
+
+struct Kernel {
+    const char* name;
+    const char* covers;
+    std::vector<uint16_t> code;
+};
+
+const std::vector<Kernel> KERNELS = {
+    {"alu", "8XYN",
+     {0x6001, 0x6103, 0x6207,
+      0x8014, 0x8121, 0x8202, 0x8013, 0x8125, 0x8206, 0x8127, 0x820E, 0x8310,
+      0x1206}},
+    {"branch", "3XNN 4XNN 5XY0",
+     {0x6000, 0x6100,
+      0x7001, 0x3080, 0x4040, 0x5010, 0x7100,
+      0x1204}},
+    {"draw", "DXYN",
+     {0xA050, 0x6000, 0x6100,
+      0xD015, 0x7003, 0x7101, 0xD018, 0x7105,
+      0x1206}},
+    {"block_copy", "FX55 FX65",
+     {0xA300, 0xFF55, 0xA300, 0xFF65, 0xA300, 0xF755, 0xA300, 0xF765,
+      0x1200}},
+};
+
+struct Result {
+    std::string name;
+    std::string kind;
+    std::string covers;
+    bool jit = false;
+    uint64_t cycles = 0;
+    double best = 0;
+    double median = 0;
+};
+
+using clock = std::chrono::steady_clock;
+
+void run_raw(Chip8& chip8, uint64_t cycles) {
+    while (cycles) {
+        const int count = static_cast<int>(std::min<uint64_t>(cycles, INT_MAX));
+        chip8.run(count);
+        cycles -= count;
+    }
+}
+
+bool idle_skipping = true;
+bool fusing = true;
+
+// best and median wall time over `repeat` fresh machines
+
+template <typename Setup, typename Body>
+void measure(Result& result, int repeat, Setup setup, Body body) {
+    std::vector<double> times;
+    for (int i = 0; i < repeat; ++i) {
+        Chip8 chip8;
+        chip8.initialize_system();
+        chip8.fusing = fusing;
+        if (!setup(chip8)) {
+            return;
+        }
+        chip8.set_jit(result.jit);
+        chip8.idle_skipping = idle_skipping;
+        // warm the decode cache / translations before timing
+        body(chip8, result.cycles / 10);
+        const auto start = clock::now();
+        body(chip8, result.cycles);
+        times.push_back(std::chrono::duration<double>(clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    result.best = times.front();
+    result.median = times[times.size() / 2];
+}
+
+std::string json_escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void print_json(const std::vector<Result>& results) {
+    std::printf("{\n  \"version\": 1,\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::printf("    {\"name\": \"%s\", \"kind\": \"%s\", \"covers\": \"%s\", \"mode\": \"%s\", "
+                    "\"cycles\": %llu, \"seconds_best\": %.6f, \"seconds_median\": %.6f, "
+                    "\"ns_per_instruction\": %.3f, \"mips\": %.2f}%s\n",
+                    json_escape(r.name).c_str(), r.kind.c_str(), r.covers.c_str(), r.jit ? "jit" : "interp",
+                    static_cast<unsigned long long>(r.cycles), r.best, r.median,
+                    r.best * 1e9 / r.cycles, r.cycles / r.best / 1e6,
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<bool> modes = {false};
+    uint64_t cycles = 20000000;
+    int repeat = 5;
+    std::vector<std::string> roms;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--mode" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "interp") {
+                modes = {false};
+            } else if (mode == "jit") {
+                modes = {true};
+            } else if (mode == "both") {
+                modes = {false, true};
+            } else {
+                std::cerr << "Unknown mode > " << mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cycles" && i + 1 < argc) {
+            cycles = std::stoull(argv[++i]);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--no-idle-skip") {
+            idle_skipping = false;
+        } else if (arg == "--no-fuse") {
+            fusing = false;
+        } else if (arg.starts_with("--")) {
+            std::cerr << "usage: " << argv[0] << " [--mode interp|jit|both] [--cycles <n>] [--repeat <n>] [--no-idle-skip] [--no-fuse] [rom...]\n";
+            return 1;
+        } else {
+            roms.push_back(arg);
+        }
+    }
+    if (std::find(modes.begin(), modes.end(), true) != modes.end() && !Jit::available()) {
+        std::cerr << "No recompiler on this host, skipping jit runs.\n";
+        modes.erase(std::remove(modes.begin(), modes.end(), true), modes.end());
+    }
+
+    std::vector<Result> results;
+    for (bool jit : modes) {
+        for (const Kernel& kernel : KERNELS) {
+            Result result{kernel.name, "kernel", kernel.covers, jit, cycles};
+            measure(result, repeat,
+                    [&](Chip8& chip8) {
+                        for (size_t i = 0; i < kernel.code.size(); ++i) {
+                            chip8.memory.write(PROGRAM_START + 2 * i, kernel.code[i] >> 8);
+                            chip8.memory.write(PROGRAM_START + 2 * i + 1, kernel.code[i] & 0xFF);
+                        }
+                        chip8.invalidate_decode_cache();
+                        return true;
+                    },
+                    run_raw);
+            results.push_back(result);
+        }
+        for (const std::string& rom : roms) {
+            Result result{std::filesystem::path(rom).filename().string(), "rom", "", jit, cycles};
+            measure(result, repeat,
+                    [&](Chip8& chip8) { return chip8.load_chip8_file(rom); },
+                    [](Chip8& chip8, uint64_t count) {
+                        HeadlessBackend backend;
+                        Scheduler scheduler;
+                        scheduler.set_turbo(true);
+                        const uint64_t end = chip8.cycles + count;
+                        while (chip8.cycles < end) {
+                            scheduler.run_slice(chip8, backend, {});
+                        }
+                    });
+            if (result.best > 0) {
+                results.push_back(result);
+            }
+        }
+    }
+    print_json(results);
+    return 0;
+}
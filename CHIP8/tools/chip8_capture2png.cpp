@@ -0,0 +1,148 @@
+// Turns a capture file written by --capture into a numbered PNG sequence.
+//   chip8_capture2png [--scale <n>] <capture> <prefix>
+// writes <prefix>000000.png, <prefix>000001.png, ... one per captured frame,
+// and prints each file's cycle and frame number.
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/capture.h"
+
+namespace {
+
+const char* USAGE =
+    " [options] <capture> <prefix>\n"
+    "  --scale <n>               pixels per CHIP-8 pixel (default 4; lores frames get twice that)\n";
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put_u32(out, static_cast<uint32_t>(data.size()));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32(out, crc32(&out[start], out.size() - start));
+}
+
+// An 8-bit paletted PNG. The image data goes out as stored (uncompressed)
+// deflate blocks, which keeps this free of zlib; run the output through an
+// optimiser if size matters.
+std::vector<uint8_t> encode_png(const std::vector<uint8_t>& pixels, size_t width, size_t height, size_t scale) {
+    const size_t out_width = width * scale;
+    const size_t out_height = height * scale;
+    std::vector<uint8_t> raw;
+    raw.reserve((out_width + 1) * out_height);
+    for (size_t y = 0; y < out_height; ++y) {
+        raw.push_back(0); // filter: none
+        for (size_t x = 0; x < out_width; ++x) {
+            raw.push_back(pixels[y / scale * width + x / scale]);
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t pos = 0; pos < raw.size();) {
+        const size_t len = std::min<size_t>(raw.size() - pos, 65535);
+        zlib.push_back(pos + len == raw.size()); // last block
+        zlib.insert(zlib.end(), {static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8),
+                                 static_cast<uint8_t>(~len), static_cast<uint8_t>(~len >> 8)});
+        for (size_t i = pos; i < pos + len; ++i) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    }
+    put_u32(zlib, b << 16 | a);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> ihdr;
+    put_u32(ihdr, static_cast<uint32_t>(out_width));
+    put_u32(ihdr, static_cast<uint32_t>(out_height));
+    ihdr.insert(ihdr.end(), {8, 3, 0, 0, 0}); // 8-bit palette indices
+    put_chunk(png, "IHDR", ihdr);
+    std::vector<uint8_t> plte;
+    for (const auto& color : CAPTURE_PALETTE) {
+        plte.insert(plte.end(), color, color + 3);
+    }
+    put_chunk(png, "PLTE", plte);
+    put_chunk(png, "IDAT", zlib);
+    put_chunk(png, "IEND", {});
+    return png;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t scale = 4;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stoul(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() < 2 || scale == 0) {
+        std::cerr << "usage: " << argv[0] << USAGE;
+        return 1;
+    }
+
+    CaptureReader reader;
+    if (!reader.open(args[0])) {
+        return 1;
+    }
+    CapturedFrame frame;
+    uint32_t count = 0;
+    while (reader.next(frame)) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "%06u.png", count);
+        const std::string path = args[1] + name;
+        const size_t frame_scale = frame.header.width < SWIDTH ? scale * 2 : scale;
+        const std::vector<uint8_t> png = encode_png(frame.pixels, frame.header.width, frame.header.height, frame_scale);
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to open file > " << path << std::endl;
+            return 1;
+        }
+        std::fwrite(png.data(), 1, png.size(), file);
+        std::fclose(file);
+        std::printf("%s  cycle %llu  frame %llu\n", path.c_str(),
+                    static_cast<unsigned long long>(frame.header.cycle),
+                    static_cast<unsigned long long>(frame.header.frame));
+        ++count;
+    }
+    if (reader.error()) {
+        std::cerr << "Capture damaged after frame " << count << std::endl;
+        return 1;
+    }
+    return 0;
+}
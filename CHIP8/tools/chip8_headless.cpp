@@ -0,0 +1,265 @@
+// Runs a ROM without a window or audio device and dumps the final screen.
+//   chip8_headless [options] <rom> [cycles] [key_script]
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/debugger.h"
+#include "core/headless.h"
+#include "core/profiler.h"
+#include "core/replay.h"
+#include "core/savestate.h"
+#include "core/scheduler.h"
+#include "core/trace.h"
+
+namespace {
+
+const char* USAGE =
+    " [options] <rom> [cycles] [key_script]\n"
+    "  --jit                     run through the x86-64 recompiler\n"
+    "  --aot                     run through the ROM's compiled blocks, if linked in (chip8_aot)\n"
+    "  --ips <n>                 instructions per 60 Hz timer tick * 60 (default 600)\n"
+    "  --quirks <profile>        modern (default), vip, chip48, schip or xochip\n"
+    "  --seed <n>                CXNN random seed\n"
+    "  --load-state <file>       start from a save state\n"
+    "  --save-state <file>       save the state at the end\n"
+    "  --record <file>           write a replay of this run\n"
+    "  --replay <file>           play a replay instead and verify its final state\n"
+    "  --profile <file>          count opcodes/hotspots and time each frame, report to file\n"
+    "  --trace <categories>      cpu,draw,flow,error or all, to trace.bin\n"
+    "  --trace-level <level>     error, info or debug\n"
+    "  --capture <file>          write every presented frame to a capture file (chip8_capture2png),\n"
+    "                            or \"|command\" to pipe raw 128x64 rgb24 frames into an encoder\n"
+    "  --capture-changed         only capture frames that differ from the last one\n"
+    "  --break <addr>            stop at this (hex) address and print registers and listing\n"
+    "  --watch <first>[-<last>][:r|w|rw]\n"
+    "                            stop after an instruction reads or writes this range\n";
+
+// '#' for plane 0 (all a plain CHIP-8 ROM draws), '+' plane 1, '@' both
+void print_screen(const Framebuffer& screen) {
+    for (size_t y = 0; y < screen.height(); ++y) {
+        for (size_t x = 0; x < screen.width(); ++x) {
+            std::cout << ".#+@"[pixel_at(screen, x, y)];
+        }
+        std::cout << '\n';
+    }
+    std::cout << "framebuffer hash " << std::hex << hash_framebuffer(screen) << std::dec << '\n';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool use_jit = false;
+    bool use_aot = false;
+    uint32_t ips = Scheduler::DEFAULT_IPS;
+    uint64_t seed = DEFAULT_RNG_SEED;
+    QuirkProfile quirks = QUIRKS_MODERN;
+    std::string load_path;
+    std::string save_path;
+    std::string record_path;
+    std::string replay_path;
+    std::string profile_path;
+    std::string capture_path;
+    bool capture_changed = false;
+    Debugger debugger;
+    bool debugging = false;
+    uint8_t trace_categories = 0;
+    TraceLevel trace_level = TRACE_LEVEL_DEBUG;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--jit") {
+            use_jit = true;
+        } else if (arg == "--aot") {
+            use_aot = true;
+        } else if (arg == "--ips" && i + 1 < argc) {
+            ips = std::stoul(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--quirks" && i + 1 < argc) {
+            if (!parse_quirks(argv[++i], quirks)) {
+                return 1;
+            }
+        } else if (arg == "--load-state" && i + 1 < argc) {
+            load_path = argv[++i];
+        } else if (arg == "--save-state" && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--capture" && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (arg == "--capture-changed") {
+            capture_changed = true;
+        } else if (arg == "--break" && i + 1 < argc) {
+            uint16_t address;
+            if (!parse_debug_address(argv[++i], address)) {
+                return 1;
+            }
+            debugger.set_breakpoint(address);
+            debugging = true;
+        } else if (arg == "--watch" && i + 1 < argc) {
+            Watchpoint watch;
+            if (!parse_watchpoint(argv[++i], watch)) {
+                return 1;
+            }
+            debugger.add_watchpoint(watch);
+            debugging = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_categories = parse_trace_categories(argv[++i]);
+            if (!trace_categories) {
+                return 1;
+            }
+        } else if (arg == "--trace-level" && i + 1 < argc) {
+            if (!parse_trace_level(argv[++i], trace_level)) {
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        std::cerr << "usage: " << argv[0] << USAGE;
+        return 1;
+    }
+    if (!record_path.empty() && !load_path.empty()) {
+        std::cerr << "A replay has to start from reset, not from a save state.\n";
+        return 1;
+    }
+
+    const std::string filepath = args[0];
+    const uint64_t total_cycles = args.size() > 1 ? std::stoull(args[1]) : 1000000;
+
+    HeadlessBackend backend;
+    if (args.size() > 2 && !backend.load_key_script(args[2])) {
+        return 1;
+    }
+
+    Chip8 chip8;
+    chip8.seed_random(seed);
+    chip8.quirks = quirks;
+    chip8.initialize_system();
+    if (!chip8.load_chip8_file(filepath)) {
+        return 1;
+    }
+    if (use_aot) {
+        const AotProgram* program = find_aot_program(hash_rom(chip8), chip8.quirks);
+        if (!program) {
+            std::cerr << "No compiled blocks for this ROM linked in, interpreting instead.\n";
+        }
+        chip8.set_aot(program);
+    }
+    if (!load_path.empty() && !load_state(chip8, load_path)) {
+        return 1;
+    }
+    // [cycles] counts from wherever the loaded state left off
+    const uint64_t first_cycle = chip8.cycles;
+    if (use_jit && !chip8.set_jit(true)) {
+        std::cerr << "No recompiler on this host, interpreting instead.\n";
+    }
+
+    Tracer tracer;
+    if (trace_categories) {
+        if (!tracer.start("trace.bin")) {
+            return 1;
+        }
+        tracer.enable(trace_categories, trace_level);
+        chip8.tracer = &tracer;
+    }
+
+    std::unique_ptr<Profiler> profiler;
+    if (!profile_path.empty()) {
+        profiler = std::make_unique<Profiler>();
+        chip8.profiler = profiler.get();
+    }
+
+    if (!replay_path.empty()) {
+        Replay replay;
+        if (!load_replay(replay_path, replay)) {
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        const bool matched = play_replay(chip8, replay);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        tracer.stop();
+        print_screen(chip8.screen);
+        std::cout << "replay " << (matched ? "OK" : "MISMATCH") << " at cycle " << chip8.cycles
+                  << ", state hash " << std::hex << hash_state(chip8) << std::dec << '\n';
+        std::cerr << chip8.cycles << " cycles, " << replay.events.size() << " events in "
+                  << elapsed.count() << " s (" << chip8.cycles / elapsed.count() / 1e6 << " MIPS)\n";
+        return matched ? 0 : 2;
+    }
+
+    FrameCapture capture;
+    if (!capture_path.empty()) {
+        if (!capture.start(capture_path, capture_changed)) {
+            return 1;
+        }
+        backend.capture = &capture;
+    }
+
+    // a replay runs to its end; breakpoints are for a run of its own
+    if (debugging) {
+        chip8.debugger = &debugger;
+    }
+
+    Recorder recorder;
+    if (!record_path.empty()) {
+        recorder.begin(chip8);
+        chip8.recorder = &recorder;
+    }
+
+    // turbo: as fast as the host goes, with the timers still ticking once
+    // every ips/60 instructions
+    Scheduler scheduler(ips);
+    scheduler.set_turbo(true);
+    auto start = std::chrono::steady_clock::now();
+    while (chip8.cycles - first_cycle < total_cycles) {
+        if (profiler) {
+            const auto slice_start = std::chrono::steady_clock::now();
+            scheduler.run_slice(chip8, backend, start);
+            profiler->emulate.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - slice_start).count());
+        } else {
+            scheduler.run_slice(chip8, backend, start);
+        }
+        if (debugger.paused()) {
+            DebugView view;
+            capture_debug_view(chip8, debugger, view);
+            std::cout << format_debug_view(view);
+            break;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    tracer.stop();
+    if (tracer.dropped()) {
+        std::cerr << tracer.dropped() << " trace records dropped\n";
+    }
+    capture.stop();
+    if (!capture_path.empty()) {
+        std::cerr << capture.frames_written() << " frames captured";
+        if (capture.stalls()) {
+            std::cerr << ", emulation waited for the writer " << capture.stalls() << " times";
+        }
+        std::cerr << '\n';
+    }
+    if (!save_path.empty() && !save_state(chip8, save_path)) {
+        return 1;
+    }
+    if (!record_path.empty() && !recorder.finish(chip8, record_path)) {
+        return 1;
+    }
+    if (profiler && !profiler->write_report(chip8, profile_path)) {
+        return 1;
+    }
+
+    print_screen(backend.framebuffer);
+    const uint64_t executed = chip8.cycles - first_cycle;
+    std::cerr << executed << " cycles, " << backend.frames_presented << " frames in "
+              << elapsed.count() << " s (" << executed / elapsed.count() / 1e6 << " MIPS)\n";
+    return 0;
+}
@@ -0,0 +1,336 @@
+// Runs every ROM in a directory headlessly, in parallel, and checks the
+// results against a manifest of golden hashes.
+//   chip8_regress [options] <rom_dir> <manifest>
+//
+// Manifest: one ROM per line, # comments,
+//   <rom file> <cycles> <framebuffer hash> <state hash>
+//       [quirks=<profile>] [ips=<n>] [key script]
+// with the hashes in hex as chip8_headless prints them (state hash =
+// hash_state()), or - for "don't check". Key scripts are relative to the
+// manifest. A ROM without quirks= or ips= gets what the directory's ROM
+// library index says (the platform's, unless changed in the browser).
+// Each ROM runs like chip8_headless --quirks <profile> --ips <n> <rom>
+// <cycles> [key script] would: turbo scheduler, default seed, timers every
+// ips/60 instructions. --update writes the hashes, profile and ips seen
+// back into the manifest and adds the ROMs it didn't list yet.
+//
+// A "state_version <n>" line records the SAVESTATE_VERSION the state
+// hashes were taken under. Under any other version (or none) they can't
+// match, so only the framebuffers are checked until --update.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "core/headless.h"
+#include "core/rom_library.h"
+#include "core/savestate.h"
+#include "core/scheduler.h"
+#include "core/work_pool.h"
+
+namespace {
+
+const char* USAGE =
+    " [options] <rom_dir> <manifest>\n"
+    "  --jobs <n>                worker threads (default: one per core)\n"
+    "  --jit                     run through the x86-64 recompiler\n"
+    "  --cycles <n>              cycles for ROMs the manifest doesn't list (default 1000000)\n"
+    "  --update                  write the hashes seen back to the manifest\n";
+
+constexpr uint64_t UNCHECKED = 0;
+
+struct Entry {
+    std::string rom;
+    uint64_t cycles = 0;
+    uint64_t framebuffer_hash = UNCHECKED;
+    uint64_t state_hash = UNCHECKED;
+    QuirkProfile quirks = QUIRKS_COUNT; // QUIRKS_COUNT and 0: not in the manifest, so the index's
+    uint32_t ips = 0;
+    std::string key_script;
+    bool listed = false; // in the manifest, as opposed to just found in the directory
+};
+
+enum Outcome { PASS, FAIL, NEW, ERROR };
+
+struct Result {
+    Outcome outcome = ERROR;
+    uint64_t framebuffer_hash = 0;
+    uint64_t state_hash = 0;
+    uint64_t cycles = 0;
+    double seconds = 0;
+    std::string detail;
+};
+
+bool parse_hash(const std::string& text, uint64_t& hash) {
+    if (text == "-") {
+        hash = UNCHECKED;
+        return true;
+    }
+    try {
+        size_t used = 0;
+        hash = std::stoull(text, &used, 16);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::string format_hash(uint64_t hash) {
+    if (hash == UNCHECKED) {
+        return "-";
+    }
+    char text[20];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+bool load_manifest(const std::string& filepath, std::vector<Entry>& entries, uint32_t& state_version) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        Entry entry;
+        std::string framebuffer, state;
+        if (!(in >> entry.rom)) {
+            continue; // blank or comment
+        }
+        if (entry.rom == "state_version") {
+            if (!(in >> state_version)) {
+                std::cerr << "Bad manifest line " << line_no << " > " << line << std::endl;
+                return false;
+            }
+            continue;
+        }
+        if (!(in >> entry.cycles >> framebuffer >> state) || !parse_hash(framebuffer, entry.framebuffer_hash) ||
+            !parse_hash(state, entry.state_hash)) {
+            std::cerr << "Bad manifest line " << line_no << " > " << line << std::endl;
+            return false;
+        }
+        std::string token;
+        bool bad = false;
+        while (!bad && in >> token) {
+            if (token.starts_with("quirks=")) {
+                bad = !parse_quirks(token.substr(7), entry.quirks);
+            } else if (token.starts_with("ips=")) {
+                try {
+                    entry.ips = std::stoul(token.substr(4));
+                } catch (const std::exception&) {
+                    bad = true;
+                }
+                bad = bad || entry.ips == 0;
+            } else if (entry.key_script.empty()) {
+                entry.key_script = token;
+            } else {
+                bad = true;
+            }
+        }
+        if (bad) {
+            std::cerr << "Bad manifest line " << line_no << " > " << line << std::endl;
+            return false;
+        }
+        entry.listed = true;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool save_manifest(const std::string& filepath, const std::vector<Entry>& entries) {
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file > " << filepath << std::endl;
+        return false;
+    }
+    file << "# rom  cycles  framebuffer hash  state hash  quirks=<profile>  ips=<n>  [key script]\n";
+    file << "state_version " << SAVESTATE_VERSION << '\n';
+    for (const Entry& entry : entries) {
+        file << entry.rom << ' ' << entry.cycles << ' ' << format_hash(entry.framebuffer_hash) << ' '
+             << format_hash(entry.state_hash) << " quirks=" << quirks_name(entry.quirks) << " ips=" << entry.ips;
+        if (!entry.key_script.empty()) {
+            file << ' ' << entry.key_script;
+        }
+        file << '\n';
+    }
+    return file.good();
+}
+
+Result run_rom(const Entry& entry, const std::filesystem::path& rom_dir, const std::filesystem::path& manifest_dir,
+               bool use_jit) {
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    HeadlessBackend backend;
+    if (!entry.key_script.empty() && !backend.load_key_script((manifest_dir / entry.key_script).string())) {
+        result.detail = "can't load key script " + entry.key_script;
+        return result;
+    }
+    Chip8 chip8;
+    chip8.quirks = entry.quirks;
+    chip8.initialize_system();
+    if (!chip8.load_chip8_file((rom_dir / entry.rom).string())) {
+        result.detail = "can't load ROM";
+        return result;
+    }
+    chip8.set_jit(use_jit);
+
+    Scheduler scheduler(entry.ips);
+    scheduler.set_turbo(true);
+    while (chip8.cycles < entry.cycles) {
+        scheduler.run_slice(chip8, backend, {});
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.cycles = chip8.cycles;
+    result.framebuffer_hash = hash_framebuffer(backend.framebuffer);
+    result.state_hash = hash_state(chip8);
+
+    if (!entry.listed) {
+        result.outcome = NEW;
+    } else if (entry.framebuffer_hash != UNCHECKED && entry.framebuffer_hash != result.framebuffer_hash) {
+        result.outcome = FAIL;
+        result.detail = "framebuffer " + format_hash(result.framebuffer_hash) + ", expected " +
+                        format_hash(entry.framebuffer_hash);
+    } else if (entry.state_hash != UNCHECKED && entry.state_hash != result.state_hash) {
+        result.outcome = FAIL;
+        result.detail = "state " + format_hash(result.state_hash) + ", expected " + format_hash(entry.state_hash);
+    } else {
+        result.outcome = PASS;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned jobs = 0;
+    bool use_jit = false;
+    bool update = false;
+    uint64_t default_cycles = 1000000;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc) {
+            jobs = std::stoul(argv[++i]);
+        } else if (arg == "--jit") {
+            use_jit = true;
+        } else if (arg == "--cycles" && i + 1 < argc) {
+            default_cycles = std::stoull(argv[++i]);
+        } else if (arg == "--update") {
+            update = true;
+        } else if (arg.starts_with("--")) {
+            std::cerr << "usage: " << argv[0] << USAGE;
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() != 2) {
+        std::cerr << "usage: " << argv[0] << USAGE;
+        return 1;
+    }
+    if (use_jit && !Jit::available()) {
+        std::cerr << "No recompiler on this host, interpreting instead.\n";
+    }
+    const std::filesystem::path rom_dir = args[0];
+    const std::string manifest_path = args[1];
+    const std::filesystem::path manifest_dir = std::filesystem::path(manifest_path).parent_path();
+
+    // a manifest that isn't there yet is fine when it's about to be written
+    std::vector<Entry> entries;
+    uint32_t state_version = 0;
+    if ((!update || std::filesystem::exists(manifest_path)) && !load_manifest(manifest_path, entries, state_version)) {
+        return 1;
+    }
+    if (!entries.empty() && state_version != SAVESTATE_VERSION) {
+        std::cerr << "State hashes are from save state version " << state_version << ", not "
+                  << SAVESTATE_VERSION << "; checking framebuffers only (--update to refresh) > "
+                  << manifest_path << std::endl;
+        for (Entry& entry : entries) {
+            entry.state_hash = UNCHECKED;
+        }
+    }
+    std::map<std::string, size_t> listed;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        listed[entries[i].rom] = i;
+    }
+    for (const std::string& rom : list_rom_files(rom_dir.string())) {
+        if (!listed.count(rom)) {
+            Entry entry;
+            entry.rom = rom;
+            entry.cycles = default_cycles;
+            entries.push_back(entry);
+        }
+    }
+    // profile and speed the manifest leaves out come from the index, which
+    // is only read here: running the suite doesn't write it
+    RomLibrary library(rom_dir.string());
+    library.refresh();
+    for (Entry& entry : entries) {
+        const RomInfo* info = library.find(entry.rom);
+        if (entry.quirks == QUIRKS_COUNT) {
+            entry.quirks = info ? info->quirks : QUIRKS_MODERN;
+        }
+        if (entry.ips == 0) {
+            entry.ips = info ? info->ips : Scheduler::DEFAULT_IPS;
+        }
+    }
+
+    // longest first, so nothing long starts last
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return entries[a].cycles > entries[b].cycles; });
+    std::vector<Result> results(entries.size());
+    std::vector<std::function<void()>> tasks;
+    for (size_t i : order) {
+        tasks.push_back([&, i] { results[i] = run_rom(entries[i], rom_dir, manifest_dir, use_jit); });
+    }
+
+    WorkPool pool(jobs);
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(std::move(tasks));
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    static const char* const LABELS[] = {"PASS", "FAIL", "NEW ", "ERR "};
+    size_t counts[4] = {};
+    double busy = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Result& r = results[i];
+        ++counts[r.outcome];
+        busy += r.seconds;
+        std::printf("%s  %-32s %10.2f ms %9.1f MIPS  %s\n", LABELS[r.outcome], entries[i].rom.c_str(),
+                    r.seconds * 1e3, r.seconds > 0 ? r.cycles / r.seconds / 1e6 : 0.0, r.detail.c_str());
+    }
+    size_t stolen = 0;
+    for (size_t n : pool.stolen()) {
+        stolen += n;
+    }
+    std::printf("\n%zu passed, %zu failed, %zu new, %zu errors; %.2f s on %u threads (%.2f s of work, %zu stolen)\n",
+                counts[PASS], counts[FAIL], counts[NEW], counts[ERROR], wall, pool.threads(), busy, stolen);
+
+    if (update) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (results[i].outcome != ERROR) {
+                entries[i].framebuffer_hash = results[i].framebuffer_hash;
+                entries[i].state_hash = results[i].state_hash;
+            }
+        }
+        if (!save_manifest(manifest_path, entries)) {
+            return 1;
+        }
+        std::printf("Manifest written to %s\n", manifest_path.c_str());
+        return counts[ERROR] ? 1 : 0;
+    }
+    return counts[FAIL] || counts[ERROR] ? 1 : 0;
+}
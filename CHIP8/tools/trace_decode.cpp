@@ -0,0 +1,57 @@
+// Prints a binary trace written by --trace as one line per record.
+//   trace_decode <trace.bin>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "core/decode.h"
+#include "core/trace.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <trace.bin>\n";
+        return 1;
+    }
+
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::cerr << "Failed to open trace > " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // little-endian, like the records
+    const auto u32 = [](const uint8_t* in) {
+        return static_cast<uint32_t>(in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24);
+    };
+    uint8_t header[12];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header)
+        || std::memcmp(header, TRACE_MAGIC, 4) != 0) {
+        std::cerr << "Not a CHIP-8 trace > " << argv[1] << std::endl;
+        std::fclose(file);
+        return 1;
+    }
+    const uint32_t version = u32(header + 4);
+    const uint32_t record_size = u32(header + 8);
+    if (version != TRACE_VERSION || record_size != sizeof(TraceRecord)) {
+        std::cerr << "Unsupported trace version " << version << std::endl;
+        std::fclose(file);
+        return 1;
+    }
+
+    static const char* levels[] = {"error", "info", "debug"};
+    uint8_t bytes[sizeof(TraceRecord)];
+    while (std::fread(bytes, sizeof(bytes), 1, file) == 1) {
+        const TraceRecord record = decode_trace_record(bytes);
+        std::printf("%12llu  %03X  %04X  %-18s %-5s %-5s",
+                    static_cast<unsigned long long>(record.cycle), record.pc, record.opcode,
+                    disassemble(record.opcode).c_str(), trace_category_name(record.category),
+                    record.level <= TRACE_LEVEL_DEBUG ? levels[record.level] : "?");
+        for (int v = 0; v < 16; ++v) {
+            if (record.touched & (1 << v)) {
+                std::printf(" V%X", v);
+            }
+        }
+        std::printf("\n");
+    }
+    std::fclose(file);
+    return 0;
+}